@@ -0,0 +1,81 @@
+// Per-file cost of the type distribution update, before and after extension
+// interning. Usage: bench_extension_table [files] [distinct_extensions] [runs]
+//
+// "maps" is the previous update_aggregation: path::extension() copied into a
+// string, then one std::map lookup each for the count and the size. "table"
+// is the current one: the extension viewed in place and interned into an
+// ExtensionTable. Only the in-memory aggregation is timed, no I/O.
+#include "ExtensionTable.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace analyzer;
+
+namespace {
+
+std::vector<fs::path> make_paths(size_t files, size_t distinct) {
+    // A few common extensions dominate, as on real trees, with a long tail.
+    static const char* common[] = {".c", ".h", ".txt", ".json", ".log", ".so", ".png", ".gz", ".py", ".html"};
+    std::mt19937_64 rng(42);
+    std::vector<fs::path> paths;
+    paths.reserve(files);
+    for (size_t i = 0; i < files; ++i) {
+        std::string ext = rng() % 4 != 0 ? common[rng() % std::size(common)] : ".ext" + std::to_string(rng() % distinct);
+        if (rng() % 20 == 0) ext.clear();
+        paths.emplace_back("/srv/data/project" + std::to_string(i % 97) + "/src/file_" + std::to_string(i) + ext);
+    }
+    return paths;
+}
+
+template <typename Fn>
+double best_ns_per_file(const std::vector<fs::path>& paths, const std::vector<uint64_t>& sizes, int runs, Fn&& run) {
+    double best = 0;
+    for (int i = 0; i <= runs; ++i) { // first round is a warm-up
+        auto start = std::chrono::steady_clock::now();
+        run(paths, sizes);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (i == 1 || (i > 1 && ns < best)) best = ns;
+    }
+    return best / static_cast<double>(paths.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t files = argc > 1 ? std::stoul(argv[1]) : 2000000;
+    size_t distinct = argc > 2 ? std::stoul(argv[2]) : 200;
+    int runs = argc > 3 ? std::stoi(argv[3]) : 5;
+
+    auto paths = make_paths(files, distinct);
+    std::vector<uint64_t> sizes(paths.size());
+    for (size_t i = 0; i < sizes.size(); ++i) sizes[i] = (i * 2654435761u) % 1000000;
+    uint64_t checksum = 0;
+
+    double maps = best_ns_per_file(paths, sizes, runs, [&](const auto& p, const auto& s) {
+        std::map<std::string, uint64_t> counts;
+        std::map<std::string, uint64_t> bytes;
+        for (size_t i = 0; i < p.size(); ++i) {
+            std::string ext = p[i].has_extension() ? p[i].extension().string() : "no-extension";
+            counts[ext]++;
+            bytes[ext] += s[i];
+        }
+        checksum += counts.size();
+    });
+
+    double table = best_ns_per_file(paths, sizes, runs, [&](const auto& p, const auto& s) {
+        ExtensionTable extensions;
+        for (size_t i = 0; i < p.size(); ++i) extensions.add(extension_of(p[i]), s[i]);
+        checksum += extensions.size();
+    });
+
+    std::cout << files << " files, " << distinct << "+ distinct extensions, best of " << runs << " runs\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  maps  : " << maps << " ns/file\n";
+    std::cout << "  table : " << table << " ns/file (" << std::setprecision(2) << maps / table << "x)\n";
+    return checksum == 0; // keeps both loops observable
+}
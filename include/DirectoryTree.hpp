@@ -0,0 +1,97 @@
+#pragma once
+
+#include "FileSystemAnalyzer.hpp"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace analyzer {
+
+// Every directory the scan reaches, as one flat arena: 40 bytes per node
+// plus its name, so tens of millions of directories fit comfortably. Nodes
+// are appended as their parent is read, which keeps every parent ahead of
+// its children and lets roll_up() turn direct totals into recursive ones in
+// a single backwards pass.
+//
+// In streaming mode the tree keeps only the directories still being
+// scanned: once a directory and all of its subdirectories are recorded, its
+// totals are added to its parent, offered to the two rankings and its node
+// is reused. Memory then follows the directories in flight, not the size of
+// the tree.
+class DirectoryTree {
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId kNoParent = UINT32_MAX;
+
+    // Switches to streaming mode, keeping the top `n` of each ranking.
+    // Call before add_root().
+    void stream(size_t n);
+
+    // Sampled scans: rates[d] is the chance that a directory at depth d was
+    // scanned, given that its parent was. roll_up() then extrapolates every
+    // node's totals (Horvitz-Thompson, level by level) and estimates the
+    // variance of the root's. Call before roll_up().
+    void sample(std::vector<double> rates);
+    struct Variance {
+        double files = 0;
+        double size = 0;
+    };
+    const Variance& root_variance() const { return root_variance_; }
+
+    NodeId add_root(const fs::path& path);
+
+    // Stores what a directory holds directly and appends a node for each
+    // subdirectory, setting its task's node id. Thread-safe. In streaming
+    // mode every node must be recorded exactly once, or its ancestors never
+    // complete.
+    void record(NodeId node, uint64_t files, uint64_t size, uint64_t allocated_size, std::vector<DirectoryTask>& subdirs);
+
+    // Adds every node's totals into its ancestors. Call once, after the scan;
+    // nothing to do in streaming mode.
+    void roll_up();
+
+    // The n nodes below the root with the highest recursive size / file count.
+    std::vector<DirectorySummary> largest(size_t n) const;
+    std::vector<DirectorySummary> most_populated(size_t n) const;
+
+    // Only nodes still in the tree; in streaming mode, those in flight.
+    fs::path path(NodeId node) const;
+    size_t size() const { return nodes_.size() - free_.size(); }
+    size_t memory_usage() const { return nodes_.capacity() * sizeof(Node) + names_.capacity(); }
+
+private:
+    struct Node {
+        NodeId parent = kNoParent;
+        uint64_t name_offset = 0; // NUL-terminated in names_, which may outgrow 4 GiB
+        uint64_t files = 0;
+        uint64_t size = 0;
+        uint64_t allocated_size = 0;
+    };
+
+    NodeId append(NodeId parent, std::string&& name);
+    const char* name(NodeId node) const;
+    void finish(NodeId node);
+    void roll_up_sampled();
+    template <typename Key>
+    void offer(std::vector<DirectorySummary>& ranking, NodeId node, Key key);
+    template <typename Key>
+    std::vector<DirectorySummary> top(size_t n, Key key) const;
+
+    std::mutex mutex_;
+    std::vector<Node> nodes_;
+    std::string names_;
+
+    std::vector<double> sample_rates_; // empty unless sampled
+    Variance root_variance_;
+
+    // Streaming mode only
+    bool streaming_ = false;
+    size_t keep_ = 0;
+    std::vector<std::string> node_names_; // names_ cannot give space back
+    std::vector<uint32_t> pending_;       // unfinished subdirectories, plus one until recorded
+    std::vector<NodeId> free_;
+    std::vector<DirectorySummary> largest_;        // heaps, worst entry in front
+    std::vector<DirectorySummary> most_populated_;
+};
+
+} // namespace analyzer
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "FileSystemAnalyzer.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace analyzer {
+
+// `fs --watch`: one full scan, then the DirectoryStats is kept current from
+// inotify events instead of rescanning. Events only mark paths dirty; the
+// dirty set is re-stat'ed once per report interval, so a file written in a
+// tight loop costs one stat per interval. Linux only.
+//
+// Unlike a default fs scan, every hard link is counted as a file: a file
+// rewritten in place keeps its inode, which inode dedup would then skip.
+// The report says so.
+class DirectoryWatcher {
+public:
+    using ReportCallback = std::function<void(const DirectoryStats&)>;
+
+    explicit DirectoryWatcher(AnalysisOptions options);
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    // Scans, reports, then reports again every `interval` until stop() is
+    // called. Returns false if change notification is unavailable.
+    bool run(std::chrono::milliseconds interval, const ReportCallback& report);
+    void stop() { stop_requested_ = true; }
+
+private:
+    struct WatchedDirectory {
+        int wd = -1;        // -1: counted but not read (beyond max_depth)
+        int depth = 0;
+        uint64_t inode = 0;
+        std::shared_ptr<const IgnoreFrame> ignore; // rules for its entries (ignore-file mode)
+    };
+
+    AnalysisOptions scan_options(const fs::path& root, int base_depth, std::shared_ptr<const IgnoreFrame> ignore = nullptr);
+    void full_scan();
+    void on_directory(const fs::path& path, int depth, std::shared_ptr<const IgnoreFrame> ignore = nullptr);
+    void read_events();
+    void apply_changes();
+    void refresh_path(const std::string& path);
+    void remove_subtree(const std::string& path);
+    void refresh_ages();
+    void recount_ages();
+    void track_age(const FileEntry& entry);
+    void untrack_age(const FileEntry& entry);
+    void refill_top_lists();
+
+    AnalysisOptions options_;
+    FileSystemAnalyzer analyzer_; // incremental add/remove and the age clock
+    DirectoryStats stats_;
+
+    std::mutex index_mutex_; // scan callbacks may arrive from worker threads
+    // Ordered, so a directory's subtree is the key range [dir + "/", dir + "0").
+    std::map<std::string, FileEntry> files_;
+    std::map<std::string, WatchedDirectory> directories_;
+    // Deeper top lists than the report's, to refill its places when listed
+    // files go. After `reserve_removals_` removals from it the reserve may no
+    // longer cover the report's top n and is rebuilt from files_.
+    TopFiles reserve_;
+    size_t reserve_removals_ = 0;
+    std::unordered_map<int, std::string> watch_paths_;
+    // Files per mtime, for those not yet in the oldest age bucket: when the
+    // clock moves, only the files passing an age limit change bucket.
+    std::map<fs::file_time_type, uint64_t> recent_mtimes_;
+
+    std::set<std::string> dirty_; // ordered so parents are handled before children
+    bool overflowed_ = false;
+    bool top_lists_stale_ = false;
+    std::atomic<bool> watch_limit_warned_{false}; // set from the scan's worker threads
+    int inotify_fd_ = -1;
+    std::atomic<bool> stop_requested_{false};
+};
+
+} // namespace analyzer
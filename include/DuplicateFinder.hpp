@@ -0,0 +1,66 @@
+#pragma once
+
+#include "FileSystemAnalyzer.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace analyzer {
+
+// Files with identical content. Every path is a separate inode: hard links
+// to one inode share storage and are never reported as duplicates.
+struct DuplicateSet {
+    uint64_t size = 0;            // of each copy
+    std::vector<fs::path> paths;  // sorted
+
+    uint64_t reclaimable_bytes() const { return paths.empty() ? 0 : size * (paths.size() - 1); }
+};
+
+struct DuplicateReport {
+    std::vector<DuplicateSet> sets;  // most reclaimable first
+    uint64_t files_scanned = 0;
+    uint64_t size_candidates = 0;    // files sharing their size with another file
+    uint64_t partial_candidates = 0; // of those, files still matching after the head/tail hash
+    uint64_t bytes_read = 0;
+    uint64_t scan_errors = 0;        // entries the scan could not list or stat
+    uint64_t unreadable_files = 0;
+    std::vector<fs::path> unreadable_samples; // the first ErrorSummary::kMaxSamples of them
+    uint64_t reclaimable_bytes = 0;
+};
+
+// `dup` command. Narrows candidates in three stages so that only files which
+// are very likely duplicates are ever read in full:
+//   1. same size (from the scan itself, no I/O),
+//   2. same hash of the first and last kEdgeBytes,
+//   3. same hash of the whole content.
+// Stages 2 and 3 run on options.thread_count workers.
+class DuplicateFinder {
+public:
+    static constexpr size_t kEdgeBytes = 4096;
+
+    explicit DuplicateFinder(AnalysisOptions options);
+    ~DuplicateFinder();
+
+    DuplicateReport find();
+
+private:
+    using Digest = std::array<uint64_t, 2>;
+
+    struct Candidate {
+        fs::path path;
+        uint64_t size = 0;
+        Digest digest{};
+        bool readable = true;
+        bool fully_hashed = false; // small files are covered entirely by stage 2
+    };
+
+    std::vector<Candidate> collect(DuplicateReport& report);
+    void hash_all(std::vector<Candidate>& candidates, bool full_content, DuplicateReport& report) const;
+    bool hash_file(Candidate& candidate, bool full_content, uint64_t& bytes_read) const;
+
+    AnalysisOptions options_;
+    std::unique_ptr<IoThrottle> throttle_; // paces content reads when max_read_bytes_per_second is set
+};
+
+} // namespace analyzer
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace analyzer {
+
+enum class ErrorOperation {
+    Stat, // an entry's metadata
+    Open, // a directory
+    Read  // a directory's entries, after it was opened
+};
+
+const char* operation_name(ErrorOperation operation);
+
+// What could not be read during a scan, counted rather than printed: on a
+// tree with millions of unreadable entries a flushed stderr line each costs
+// more than the scan itself. Counts are exact; the paths kept are bounded.
+// Not thread-safe: each worker owns one, like ExtensionTable.
+struct ErrorSummary {
+    static constexpr size_t kMaxSamples = 20;     // failed paths kept
+    static constexpr size_t kMaxDirectories = 10; // directories with the most failures kept
+
+    struct Sample {
+        std::string path;
+        ErrorOperation operation = ErrorOperation::Stat;
+        int code = 0; // errno
+    };
+    struct Directory {
+        std::string path;
+        uint64_t errors = 0;
+    };
+
+    uint64_t total = 0;
+    uint64_t directories = 0;          // directories with at least one failure
+    std::map<int, uint64_t> by_code;   // errno -> failures
+    std::vector<Sample> samples;       // the first failures met, sorted by path once finalized
+    std::vector<Directory> worst_directories; // most failures first once finalized
+
+    void add(ErrorOperation operation, const std::filesystem::path& path, const std::error_code& ec) {
+        total++;
+        by_code[ec.value()]++;
+        if (samples.size() < kMaxSamples) samples.push_back({path.string(), operation, ec.value()});
+    }
+    // Called once per directory with the failures met while reading it.
+    void add_directory(const std::string& path, uint64_t errors);
+    void merge(const ErrorSummary& other);
+    void finalize();
+
+    static std::string message(int code) { return std::generic_category().message(code); }
+};
+
+} // namespace analyzer
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "SizeHistogram.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace analyzer {
+
+// Label used for files without an extension.
+inline constexpr std::string_view kNoExtension = "no-extension";
+// Label collecting the extensions beyond a table's limit.
+inline constexpr std::string_view kOtherExtensions = "other";
+
+// Extension of `path` as path::extension() defines it ("a.tar.gz" -> ".gz",
+// ".bashrc" -> none), viewed in place instead of copied into a new path.
+// Returns kNoExtension when there is none.
+std::string_view extension_of(const fs::path& path);
+std::string_view extension_of(std::string_view path);
+
+// Per-extension file counts, sizes and size histograms. Each distinct
+// extension is interned once into a small integer ID; totals live in one
+// flat array indexed by it. Looking an extension up costs one hash of a
+// string_view and usually a single probe, with no allocation. Not
+// thread-safe: each worker owns one.
+//
+// A limited table holds at most max_extensions entries, the last of them
+// kOtherExtensions: extensions first seen once the table is full are
+// counted there, so random suffixes cannot grow it without bound.
+class ExtensionTable {
+public:
+    struct Totals {
+        uint64_t count = 0;
+        uint64_t size = 0;
+    };
+
+    explicit ExtensionTable(unsigned histogram_precision = SizeHistogram::kDefaultPrecision, size_t max_extensions = 0)
+        : histogram_precision_(histogram_precision), max_extensions_(max_extensions) {}
+
+    // Memory one entry can take at most, histogram included, for sizing
+    // max_extensions.
+    static size_t entry_bytes(unsigned histogram_precision);
+
+    uint32_t intern(std::string_view extension);
+
+    // One file of `size` bytes.
+    void add(uint32_t id, uint64_t size) {
+        totals_[id].count++;
+        totals_[id].size += size;
+        histograms_[id].add(size);
+    }
+    void add(std::string_view extension, uint64_t size) { add(intern(extension), size); }
+    void remove(std::string_view extension, uint64_t size);
+
+    // Bulk totals without histogram updates, for replaying saved results.
+    void add_totals(uint32_t id, uint64_t count, uint64_t size) {
+        totals_[id].count += count;
+        totals_[id].size += size;
+    }
+
+    void merge(const ExtensionTable& other);
+    // Multiplies counts, sizes and histograms by `weight`, for extrapolating
+    // a sample.
+    void scale(double weight);
+
+    size_t size() const { return names_.size(); }
+    const std::string& name(uint32_t id) const { return names_[id]; }
+    const Totals& totals(uint32_t id) const { return totals_[id]; }
+    const SizeHistogram& histogram(uint32_t id) const { return histograms_[id]; }
+    SizeHistogram& histogram(uint32_t id) { return histograms_[id]; }
+
+    // Map form used by reports; extensions whose count dropped to zero are left out.
+    void export_to(std::map<std::string, uint64_t>& counts, std::map<std::string, uint64_t>& sizes,
+                   std::map<std::string, SizePercentiles>& percentiles) const;
+
+private:
+    void grow();
+
+    std::vector<std::string> names_;
+    std::vector<uint64_t> hashes_;
+    std::vector<Totals> totals_;
+    std::vector<SizeHistogram> histograms_;
+    unsigned histogram_precision_;
+    size_t max_extensions_; // 0 = no limit
+    std::vector<uint32_t> slots_; // open addressing over ids, 0 = empty, else id + 1
+};
+
+} // namespace analyzer
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+struct statx;
+#endif
+
+namespace analyzer {
+
+// Bit set of the stat fields a scan actually consumes. On Linux this maps
+// directly onto a statx() mask so the kernel (and network filesystems in
+// particular) can skip work for fields nobody reads.
+enum MetadataField : unsigned {
+    kFieldType     = 1u << 0,
+    kFieldSize     = 1u << 1,
+    kFieldModTime  = 1u << 2,
+    kFieldBlocks   = 1u << 3,
+    kFieldInode    = 1u << 4,
+    kFieldOwner    = 1u << 5,
+    kFieldAccessTime = 1u << 6,
+    kFieldChangeTime = 1u << 7,
+};
+
+struct FileMetadata {
+    fs::file_type type = fs::file_type::unknown;
+    uint64_t size = 0;
+    uint64_t blocks = 0; // 512-byte units actually allocated
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint32_t nlink = 1;
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+    fs::file_time_type last_modified{};
+    fs::file_time_type last_accessed{};
+    fs::file_time_type last_changed{}; // inode change (ctime)
+};
+
+// Exactly one stat-family syscall per call (statx on Linux, fstatat on other
+// POSIX systems). `name` is resolved relative to `dir_fd`; pass kCurrentDirFd
+// with a full path to stat by path. A symlink is described itself unless
+// `follow_symlinks` asks for its target.
+bool read_metadata(int dir_fd, const char* name, unsigned fields, FileMetadata& out, std::error_code& ec,
+                   bool follow_symlinks = false);
+
+extern const int kCurrentDirFd;
+
+#ifdef __linux__
+// Shared with the io_uring engine, which issues the same statx asynchronously.
+unsigned statx_mask(unsigned fields);
+void fill_metadata(const struct ::statx& stx, FileMetadata& out);
+#endif
+
+} // namespace analyzer
@@ -1,10 +1,21 @@
 #pragma once
 
+#include "ErrorSummary.hpp"
+#include "ExtensionTable.hpp"
+#include "FileMetadata.hpp"
+#include "MountTable.hpp"
+#include "OwnerTable.hpp"
+#include "PathMatcher.hpp"
+#include "TopFiles.hpp"
+#include <array>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
 #include <filesystem>
 #include <chrono>
+#include <functional>
+#include <memory>
 
 namespace fs = std::filesystem;
 
@@ -13,17 +24,90 @@ namespace analyzer {
 struct FileEntry {
     fs::path path;
     uint64_t size;
+    uint64_t allocated_size = 0;
     std::string extension;
     fs::file_time_type last_modified;
+    fs::file_time_type last_accessed{}; // only read when an atime ranking is enabled
+    fs::file_time_type last_changed{};  // likewise for ctime
+    uint32_t uid = 0;                   // only read when owner usage is enabled
+    uint32_t gid = 0;
+};
+
+// Recursive totals of one directory, everything below it included.
+struct DirectorySummary {
+    fs::path path;
+    uint64_t files = 0;
+    uint64_t size = 0;
+    uint64_t allocated_size = 0;
+};
+
+// Usage of one user or group, with its name resolved for the report.
+struct OwnerSummary {
+    uint32_t id = 0;
+    std::string name;
+    uint64_t files = 0;
+    uint64_t size = 0;
+    uint64_t allocated_size = 0;
+};
+
+// What the scan found on one mounted filesystem.
+struct MountSummary {
+    fs::path mount_point;
+    std::string fs_type;
+    std::string source;
+    uint64_t directories = 0; // directories read
+    uint64_t files = 0;
+    uint64_t size = 0;
+    uint64_t allocated_size = 0;
+};
+
+// How a sampled scan (AnalysisOptions::sample_fraction < 1) was taken and
+// how far its extrapolated totals can be trusted. Margins are half-widths of
+// 95% confidence intervals.
+struct SampleSummary {
+    double fraction = 1; // 1: not sampled, every figure is exact
+    uint64_t seed = 0;
+    uint64_t directories_scanned = 0;
+    uint64_t files_scanned = 0;
+    unsigned depth = 0;       // level whose subtrees were sampled; 0 if none was wide enough (exact scan)
+    bool complete = true;     // false if a budget stopped the scan before its last level
+    unsigned depth_reached = 0;
+    double files_margin = 0;
+    double size_margin = 0;
+    double design_effect = 1; // variance of total_files relative to sampling files at random
+
+    bool sampled() const { return fraction < 1; }
+    // Margin of a count that is `count` of `total` files, from the design
+    // effect of the file total.
+    double count_margin(uint64_t count, uint64_t total) const;
 };
 
 struct DirectoryStats {
     uint64_t total_files = 0;
     uint64_t total_directories = 0;
-    uint64_t total_size = 0;
+    uint64_t total_size = 0;           // apparent size (st_size)
+    uint64_t total_allocated_size = 0; // blocks actually allocated (st_blocks * 512), what du reports
+    uint64_t hard_links_skipped = 0;   // extra links to an inode that was already counted
+    bool counts_every_link = false;    // count_hard_links (always in watch mode): each link is a file
+    uint64_t directories_revisited = 0; // symlinked directories already scanned (duplicates and cycles)
+
+    // Set when a time limit or an interrupt stopped the scan early: every
+    // figure covers only what was read by then. Directories found but never
+    // read are counted, and the first kMaxUnvisitedListed of them named
+    // (sorted by finalize()); their subtrees are missing entirely.
+    static constexpr size_t kMaxUnvisitedListed = 100;
+    bool partial = false;
+    uint64_t directories_unvisited = 0;
+    std::vector<std::string> unvisited_directories;
+    ErrorSummary errors; // entries and directories that could not be read
     
+    // Per-extension totals as the scan keeps them; the two maps are their
+    // report form, filled by finalize() once counting is done.
+    ExtensionTable extensions;
     std::map<std::string, uint64_t> type_distribution_count; // ext -> count
     std::map<std::string, uint64_t> type_distribution_size;  // ext -> total size
+    std::map<std::string, SizePercentiles> type_size_percentiles;
+    SizePercentiles size_percentiles; // over all files, from the per-extension histograms
     
     // Size distribution (histogram)
     struct Range {
@@ -33,33 +117,246 @@ struct DirectoryStats {
     std::vector<Range> size_histogram;
     std::vector<Range> age_distribution;
 
+    // Per uid and gid, when AnalysisOptions::owner_usage is set; the lists
+    // are their report form, largest first, filled by finalize().
+    OwnerTable user_usage;
+    OwnerTable group_usage;
+    std::vector<OwnerSummary> users;
+    std::vector<OwnerSummary> groups;
+
+    // Live rankings; the *_files lists are their best-first report form,
+    // filled by finalize(). Rankings that are not enabled stay empty.
+    TopFiles top_files;
     std::vector<FileEntry> largest_files;
     std::vector<FileEntry> oldest_files;
     std::vector<FileEntry> newest_files;
+    std::vector<FileEntry> least_accessed_files;
+    std::vector<FileEntry> recently_changed_files;
+
+    // Subdirectories of the scan root, ranked once the whole tree is known.
+    std::vector<DirectorySummary> largest_directories;        // by recursive size
+    std::vector<DirectorySummary> most_populated_directories; // by recursive file count
+    std::vector<MountSummary> mounts; // per mount reached, when the tree spans several
+    SampleSummary sample;
+
+    // Folds another partial result (e.g. from a worker thread) into this one.
+    // Top lists are re-ranked so the outcome does not depend on merge order.
+    // Directory rankings are not mergeable and are left untouched.
+    void merge(const DirectoryStats& other);
+    // Multiplies every count and size by `weight`, so a sample stands for
+    // what it was drawn from. Top lists name real files and errors were
+    // really met; both are left alone.
+    void scale(double weight);
+    void finalize();
+};
+
+enum class TraversalBackend {
+    Portable, // std::filesystem::directory_iterator
+    Native    // Linux getdents64 + fd-relative fstatat, falls back to Portable elsewhere
+};
+
+enum class MetadataEngine {
+    Sync,   // one blocking statx per file
+    IoUring // batched statx through io_uring (native backend only), sync fallback
 };
 
+struct DirectoryTask;
+struct IgnoreFrame;
+class DirectoryHandle;
+class ScanProgress;
+
 struct AnalysisOptions {
     fs::path target_path;
     int max_depth = -1; // -1 for infinite
-    std::vector<std::string> include_patterns;
+    std::vector<std::string> include_patterns; // globs, see PathMatcher
     std::vector<std::string> exclude_patterns;
+    fs::path pattern_root; // where patterns with a slash are anchored; empty = target_path
+    bool use_ignore_files = false; // skip what .gitignore/.ignore files in the tree ignore
+    std::shared_ptr<const IgnoreFrame> ignore_base; // ignore rules above target_path, for scans of a subtree
+    bool one_file_system = false;         // do not cross into other devices' mounts
+    bool skip_pseudo_filesystems = true;  // do not descend into proc, sysfs and the like
+    unsigned shard_index = 0; // with shard_count > 1, scan only the top-level entries
+    unsigned shard_count = 1; // whose name hashes to shard_index
     uint64_t min_size_threshold = 0;
     bool skip_hidden = true;
+    size_t top_count = 10;                 // entries per file and directory ranking
+    unsigned histogram_precision = SizeHistogram::kDefaultPrecision; // sub-bucket bits of the size histograms
+    unsigned rankings = kDefaultRankings;  // ranking_bit() set of file rankings to keep
+    bool count_hard_links = false; // true: every link counts, as before; false: each inode once, like du
+    // Follow symlinks to files and directories. Every directory is then
+    // scanned once by (device, inode), whatever path reaches it first, which
+    // also breaks cycles; files are counted once unless count_hard_links.
+    bool follow_symlinks = false;
+    bool owner_usage = false; // files and bytes per uid and gid
+    unsigned thread_count = 1; // >1 enables the work-stealing parallel scan
+    TraversalBackend backend = TraversalBackend::Portable;
+    MetadataEngine metadata_engine = MetadataEngine::Sync;
+    unsigned uring_queue_depth = 256;
+    fs::path cache_path; // non-empty enables the incremental rescan cache
+    // Bytes; non-zero caps every structure that grows with the tree: the
+    // extension tables (overflow goes to kOtherExtensions), the hard-link set
+    // (overflow goes to a Bloom filter) and the directory rankings (streamed).
+    // The cache, which holds every directory, is not used.
+    size_t memory_budget = 0;
+    // Background mode: stat calls and directory bytes read per second
+    // (0 = unlimited), scaled down while observed latency is above
+    // latency_target (0 = a multiple of the lowest latency seen).
+    double max_stats_per_second = 0;
+    double max_read_bytes_per_second = 0;
+    std::chrono::milliseconds latency_target{0};
+    bool idle_io_priority = false; // idle I/O class for the scanning threads
+    // Sampling: at the first level wide enough, each subtree is scanned with
+    // probability sample_fraction and what is found is extrapolated (1 = full
+    // scan). The scan goes level by level and stops early once it has run for
+    // sample_time_budget or read sample_entry_budget entries (0 = no limit).
+    double sample_fraction = 1;
+    uint64_t sample_seed = 0;
+    std::chrono::milliseconds sample_time_budget{0};
+    uint64_t sample_entry_budget = 0;
+    // Stop reading directories once time_limit has passed (0 = none) or once
+    // *cancel turns true (e.g. from a signal handler), and return what was
+    // counted, marked partial. A sampled scan treats either as its budget.
+    std::chrono::milliseconds time_limit{0};
+    const std::atomic<bool>* cancel = nullptr;
+
+    // Optional observers, called for every counted file and every directory
+    // the walk reaches (including those past max_depth, which are counted but
+    // not read). Must be thread-safe when thread_count > 1. Directories
+    // replayed from the cache do not report their files.
+    std::function<void(const FileEntry&, const FileMetadata&)> on_file;
+    std::function<void(const DirectoryTask&)> on_directory;
+    // Live counters for a progress reporter, bumped once per directory read.
+    ScanProgress* progress = nullptr;
+};
+
+struct DirectoryTask {
+    fs::path path;
+    int depth = 0;
+    uint32_t node = 0; // DirectoryTree node, assigned when the parent is recorded
+    std::shared_ptr<const IgnoreFrame> ignore = nullptr; // ignore rules for this directory's entries, if any
+    uint32_t mount = 0; // index of its mount among those below the scan root
+    // Native backend: the parent directory, still open, to open this one by
+    // name relative to it. Null for the root, mount points, directories found
+    // through the cache and once too many handles are open.
+    std::shared_ptr<const DirectoryHandle> parent = nullptr;
 };
 
+// Everything scan_directory produces for one directory besides the stats.
+struct DirectoryScan {
+    std::vector<DirectoryTask> subdirs;
+    bool complete = true;                        // false if any entry could not be read
+    bool cacheable = true;                       // false if it holds hard links, whose dedup is order dependent
+    bool record_files = false;                   // requested by the incremental cache
+    std::vector<fs::file_time_type> file_mtimes; // mtimes of the files counted here
+    std::vector<std::pair<std::string, FileMetadata>> stated_files; // every regular file stat'ed, counted or not
+
+    void clear() {
+        subdirs.clear();
+        complete = true;
+        cacheable = true;
+        record_files = false;
+        file_mtimes.clear();
+        stated_files.clear();
+    }
+};
+
+class DirectoryTree;
+class InodeSet;
+class IoThrottle;
+class ScanCache;
+struct CachedDirectory;
+
 class FileSystemAnalyzer {
 public:
     explicit FileSystemAnalyzer(AnalysisOptions options);
+    ~FileSystemAnalyzer();
     
     DirectoryStats analyze();
 
+    // Incremental maintenance of a DirectoryStats produced by analyze(), used
+    // by long-running modes such as watch. remove_file() returns true when the
+    // entry was in a top list; the caller must then refill the lists from its
+    // own file index through update_top_lists().
+    bool add_file(const fs::path& path, const FileMetadata& metadata, DirectoryStats& stats);
+    bool remove_file(const FileEntry& entry, DirectoryStats& stats) const;
+    void update_top_lists(const FileEntry& entry, DirectoryStats& stats) const;
+    void reset_clock(); // moves the age reference point to "now"
+    fs::file_time_type clock() const { return scan_time_; }
+    // Ages below kAgeLimits[i] (and not below the limits before it) fall in
+    // age bucket i; older ones in the last bucket.
+    static constexpr std::array<std::chrono::hours, 3> kAgeLimits{
+        std::chrono::hours(24), std::chrono::hours(24 * 7), std::chrono::hours(24 * 30)};
+    size_t age_bucket(fs::file_time_type last_modified) const;
+    static size_t size_bucket(uint64_t size);
+    unsigned metadata_fields() const { return metadata_fields_; }
+    // Options that change what a scan counts, as one string; the shards of
+    // one scan share it.
+    std::string fingerprint() const;
+    // Whether include/exclude patterns, and the ignore rules of its directory
+    // if given, let `path` (below the pattern root) be counted.
+    bool selects(const fs::path& path, fs::file_type type, const IgnoreFrame* ignore = nullptr) const;
+    const DirectoryTree& tree() const { return *tree_; }
+
 private:
-    void traverse(const fs::path& path, int current_depth, DirectoryStats& stats);
-    void process_file(const fs::path& path, DirectoryStats& stats);
-    void update_aggregation(const FileEntry& entry, DirectoryStats& stats);
+    void traverse(DirectoryTask root, DirectoryStats& stats);
+    struct SampleBudget;
+    void traverse_sampled(DirectoryTask root, DirectoryStats& stats);
+    size_t scan_level(std::vector<DirectoryTask>& level, DirectoryStats& stats, std::vector<DirectoryTask>& next,
+                      SampleBudget& budget);
+    bool sampled(const fs::path& subdir) const;
+    void traverse_parallel(DirectoryTask root, DirectoryStats& stats);
+    bool stop_requested();
+    void skip_directory(const DirectoryTask& task, DirectoryStats& stats);
+    void scan_directory(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out);
+    void scan_directory_contents(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out);
+    void scan_directory_uncached(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out);
+    void scan_directory_portable(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out);
+    void scan_directory_native(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out);
+    bool process_file(const fs::path& path, const FileMetadata& metadata, DirectoryStats& stats);
+    std::string cache_fingerprint() const;
+    CachedDirectory make_cache_record(const DirectoryStats& partial, const DirectoryScan& scan) const;
+    DirectoryStats replay_cache_record(const CachedDirectory& record, const DirectoryTask& task) const;
+    bool cached_files_unchanged(const CachedDirectory& record, const DirectoryTask& task) const;
+    unsigned required_metadata_fields() const;
+    std::string_view relative_dir(const fs::path& dir) const;
+    void load_mounts();
+    void apply_memory_budget();
+    void start_throttle();
+    bool stat_entry(int dir_fd, const char* path, unsigned fields, FileMetadata& metadata, std::error_code& ec,
+                    bool follow_symlinks = false) const;
+    bool first_visit(const FileMetadata& directory, bool through_link, DirectoryStats& stats) const;
+    void enter_mounts(const DirectoryTask& task, std::vector<DirectoryTask>& subdirs) const;
+    bool in_other_shard(const DirectoryTask& task, std::string_view name) const;
+    bool skips_directory(const DirectoryTask& task, std::string_view dir, std::string_view name) const;
+    bool skips_file(const DirectoryTask& task, std::string_view dir, std::string_view name) const;
     
     AnalysisOptions options_;
-    void initialize_histogram(DirectoryStats& stats);
+    const uint64_t id_;        // tells instances apart in per-thread state (the io_uring engine)
+    unsigned metadata_fields_; // stat fields requested per file, derived from options_
+    PathMatcher matcher_;      // compiled include/exclude patterns
+    std::string pattern_root_;
+
+    // Mounts the scan may reach: [0] holds target_path, the others are
+    // mount points below it. Each distinct device gets a worker group.
+    struct ScanMount {
+        MountInfo info;
+        unsigned group = 0;
+        bool skipped = false; // pseudo filesystem or, with one_file_system, another device
+    };
+    std::vector<ScanMount> mounts_;
+    std::vector<std::pair<std::string, uint32_t>> mount_points_; // sorted (path relative to the target, index)
+    unsigned device_groups_ = 1;
+    size_t max_extensions_ = 0; // per ExtensionTable, from memory_budget
+    fs::file_time_type scan_time_; // fixed reference point for age buckets
+    std::unique_ptr<ScanCache> cache_;
+    std::unique_ptr<InodeSet> linked_inodes_; // (dev, ino) of counted files with nlink > 1, or all with follow_symlinks
+    std::unique_ptr<InodeSet> visited_directories_; // (dev, ino) of directories entered, with follow_symlinks
+    std::vector<uint64_t> pseudo_devices_;          // of every pseudo filesystem mounted, for followed links
+    std::unique_ptr<DirectoryTree> tree_;     // per-directory totals of the last analyze()
+    std::unique_ptr<IoThrottle> throttle_;    // set while a rate limit applies
+    std::chrono::steady_clock::time_point deadline_; // from time_limit; max() if none
+    std::atomic<bool> stopped_{false};               // latched once the time limit or cancel hits
+    void initialize_stats(DirectoryStats& stats) const;
 };
 
 } // namespace analyzer
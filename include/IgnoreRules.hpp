@@ -0,0 +1,60 @@
+#pragma once
+
+#include "PathMatcher.hpp"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace analyzer {
+
+// The rules of one directory's .gitignore and .ignore files, in gitignore
+// syntax: '#' comments, '!' re-includes, trailing '/' for directories only,
+// and patterns relative to that directory. As in git, the last matching rule
+// decides. Consecutive rules of the same kind are folded into one GlobSet,
+// so a file without '!' lines costs a single set lookup.
+class IgnoreRules {
+public:
+    enum class Verdict { None, Ignore, Keep };
+
+    void parse(std::string_view text);
+    bool empty() const { return runs_.empty(); }
+
+    // `dir` is relative to the directory holding the rules.
+    Verdict match(std::string_view dir, std::string_view name, bool is_directory) const;
+
+private:
+    struct Run {
+        bool negated = false;
+        GlobSet any;
+        GlobSet directories;
+    };
+
+    std::vector<Run> runs_;
+};
+
+// The ignore rules in force inside one directory, as a stack from the scan
+// root down. Only directories that have ignore files push a frame; all
+// others share their parent's, so matching walks just the rules that apply.
+struct IgnoreFrame {
+    std::shared_ptr<const IgnoreFrame> parent;
+    std::string base; // directory of the rules, relative to the scan root
+    IgnoreRules rules;
+};
+
+// Names of the files load_ignore_frame() reads.
+bool is_ignore_file(std::string_view name);
+
+// `parent` plus the ignore files of `path` (at `base` below the scan root),
+// or `parent` itself when there are none.
+std::shared_ptr<const IgnoreFrame> load_ignore_frame(std::shared_ptr<const IgnoreFrame> parent, const fs::path& path,
+                                                     std::string_view base);
+
+// Whether the innermost rule that has a say ignores `name` in `dir`
+// (relative to the scan root).
+bool is_ignored(const IgnoreFrame* frame, std::string_view dir, std::string_view name, bool is_directory);
+
+} // namespace analyzer
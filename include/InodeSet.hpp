@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace analyzer {
+
+// Thread-safe set of (device, inode) pairs, used to count each hard-linked
+// inode once. Open addressing with linear probing over flat 16-byte slots,
+// split into independently locked shards so parallel workers rarely
+// contend. Only inodes with nlink > 1 are ever inserted, which keeps it
+// small even on trees with tens of millions of files.
+//
+// With a memory limit, pairs that no longer fit go into a fixed-size Bloom
+// filter instead. Its false positives make a few first links look like
+// repeats, so totals can then come out slightly low, but memory stays flat.
+class InodeSet {
+public:
+    explicit InodeSet(size_t shard_count = 64);
+
+    // Caps the set at about `max_bytes`. Call before the first insert.
+    void limit(size_t max_bytes);
+
+    // Returns true if the pair was not present yet.
+    bool insert(uint64_t device, uint64_t inode);
+    size_t size() const;
+    // Pairs that went to the Bloom filter.
+    uint64_t sketched() const { return sketched_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        uint64_t device = 0;
+        uint64_t inode = 0; // (0, 0) marks an empty slot; no real file has it
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Slot> slots;
+        size_t count = 0;
+    };
+
+    static uint64_t hash(uint64_t device, uint64_t inode);
+    static void place(std::vector<Slot>& slots, const Slot& slot, uint64_t h);
+    void grow(Shard& shard);
+    bool insert_sketch(uint64_t h);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t max_slots_ = SIZE_MAX; // per shard
+    std::unique_ptr<std::atomic<uint64_t>[]> sketch_;
+    size_t sketch_mask_ = 0; // bit count - 1
+    std::atomic<uint64_t> sketched_{0};
+};
+
+} // namespace analyzer
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "FileSystemAnalyzer.hpp"
+#include <array>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace analyzer {
+
+// One file or directory of an inventory. Paths are relative to the scan
+// root, which itself is the directory with the empty path.
+struct InventoryRecord {
+    std::string path;
+    bool directory = false;
+    uint64_t size = 0;           // files only
+    uint64_t allocated_size = 0; // files only
+    int64_t mtime = 0;           // files only, file_time_type ticks
+};
+
+// Inventory order: component by component, so that a directory is followed
+// directly by everything below it ("a", "a/b", "a.b" rather than the plain
+// byte order "a", "a.b", "a/b").
+bool inventory_order(std::string_view a, std::string_view b);
+
+// Writes the inventory of one scan (`fs --inventory=FILE`): every file and
+// directory, sorted by inventory_order() and front-coded, each path storing
+// only what differs from the one before. Records arrive in scan order from
+// any number of threads; they are sorted in memory up to `buffer_bytes`,
+// spilled to sorted runs next to the output beyond that, and the runs are
+// merged by finish(). Memory stays at the buffer however large the tree:
+// half of it fills while the other, full half is sorted and written outside
+// the lock, so scanning threads do not wait on a spill. Each thread collects
+// its records in a batch of its own and takes the lock once per batch.
+class InventoryWriter {
+public:
+    static constexpr size_t kDefaultBufferBytes = size_t{64} << 20;
+
+    InventoryWriter(fs::path file, const fs::path& root, size_t buffer_bytes = kDefaultBufferBytes);
+    ~InventoryWriter();
+
+    // Thread-safe. `path` as the scan reports it, i.e. below `root`.
+    void add_file(const FileEntry& entry);
+    void add_directory(const fs::path& path);
+
+    // Writes the inventory; false if it or a spilled run could not be written.
+    bool finish();
+
+private:
+    struct Batch {
+        std::vector<InventoryRecord> records;
+        size_t bytes = 0;
+    };
+    static constexpr size_t kBatchRecords = 1024;
+
+    void add(InventoryRecord record);
+    Batch& local();
+    void hand_over(Batch& batch);
+    void take(Batch& batch); // with mutex_ held
+    fs::path next_run();
+    bool write_run(const fs::path& run, std::vector<InventoryRecord>& records) const;
+    std::string relative(const fs::path& path) const;
+
+    const uint64_t id_; // tells instances apart in the per-thread lookup
+    fs::path file_;
+    std::string root_;
+    size_t buffer_bytes_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Batch>> batches_; // one per thread that added records
+    std::condition_variable spilled_;
+    std::vector<InventoryRecord> buffer_;
+    size_t buffered_bytes_ = 0;
+    bool spilling_ = false; // a full buffer is being written; at most one at a time
+    std::vector<fs::path> runs_;
+    bool failed_ = false;
+};
+
+// Streams the records of an inventory back in order.
+class InventoryReader {
+public:
+    // Returns false, with a warning, for a missing or foreign file.
+    bool open(const fs::path& file);
+    // False at the end, or at damage, which also sets failed().
+    bool next(InventoryRecord& record);
+
+    const std::string& root() const { return root_; }
+    bool failed() const { return failed_; }
+
+private:
+    std::ifstream in_;
+    fs::path file_;
+    std::string root_;
+    std::string path_; // previous path, for front coding
+    bool failed_ = false;
+};
+
+enum class Change { Appeared, Disappeared, Grew, Shrank };
+constexpr size_t kChangeKinds = 4;
+
+struct PathChange {
+    std::string path;
+    uint64_t old_size = 0;
+    uint64_t new_size = 0;
+};
+
+// Every path that changed one way, and the largest of them by size change.
+struct ChangeSet {
+    uint64_t count = 0;
+    uint64_t bytes = 0;               // total size change, as a magnitude
+    std::vector<PathChange> largest;  // largest change first
+};
+
+struct ExtensionChange {
+    std::string extension;
+    uint64_t old_count = 0;
+    uint64_t new_count = 0;
+    uint64_t old_size = 0;
+    uint64_t new_size = 0;
+};
+
+// What changed between two inventories of one tree. Directory sizes are
+// recursive; a directory only counts as grown or shrunk when its total did.
+struct InventoryDiff {
+    std::string old_root;
+    std::string new_root;
+    uint64_t old_files = 0, new_files = 0;
+    uint64_t old_directories = 0, new_directories = 0;
+    uint64_t old_size = 0, new_size = 0;
+    uint64_t old_allocated_size = 0, new_allocated_size = 0;
+    uint64_t files_modified = 0; // same size, different mtime
+    std::array<ChangeSet, kChangeKinds> files;       // indexed by Change
+    std::array<ChangeSet, kChangeKinds> directories;
+    std::vector<ExtensionChange> extensions; // changed ones, most growth first
+};
+
+// `diff` command: one merge-join pass over both inventories. Memory holds
+// the directories open along the current path, the top_n lists and the
+// per-extension totals, not the trees. Returns false, with a warning, if
+// either file cannot be read to its end.
+bool diff_inventories(const fs::path& old_file, const fs::path& new_file, size_t top_n, InventoryDiff& diff);
+
+} // namespace analyzer
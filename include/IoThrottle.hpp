@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace analyzer {
+
+// Paces a scan's I/O so it can run next to a latency-sensitive service.
+// Two token buckets, one for metadata calls and one for bytes read, shared
+// by all workers: each caller reserves its share of the rate and sleeps
+// until its slot comes up, so the limits hold for the process as a whole.
+//
+// The rates also adapt to the latency the scan itself sees: when the
+// average time per operation climbs past the target, the pacing halves,
+// and it recovers step by step while latency stays below it (AIMD). The
+// default target is a multiple of the lowest average seen, which follows
+// the device without needing to know what it is.
+class IoThrottle {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Limits {
+        double stats_per_second = 0; // 0 = unlimited
+        double bytes_per_second = 0; // 0 = unlimited
+        std::chrono::nanoseconds latency_target{0}; // 0 = automatic
+    };
+
+    explicit IoThrottle(Limits limits);
+
+    // Block until `count` more stats / `bytes` more bytes fit the rate.
+    void pace_stats(uint64_t count) { pace(stats_, static_cast<double>(count)); }
+    void pace_bytes(uint64_t bytes) { pace(bytes_, static_cast<double>(bytes)); }
+
+    // `count` operations took `elapsed` in all.
+    void observe(Clock::duration elapsed, uint64_t count);
+
+    // Fraction of the configured rates currently allowed, in (0, 1].
+    double scale() const;
+
+private:
+    struct Bucket {
+        double rate = 0;
+        Clock::time_point next{};
+    };
+
+    void pace(Bucket& bucket, double amount);
+
+    mutable std::mutex mutex_;
+    Bucket stats_;
+    Bucket bytes_;
+    std::chrono::nanoseconds latency_target_;
+    double scale_ = 1.0;
+    double average_ns_ = 0;  // moving average per operation
+    double baseline_ns_ = 0; // lowest average, drifting slowly upwards
+    Clock::time_point last_adjustment_{};
+};
+
+// Puts the calling thread, and threads it starts afterwards, in the idle
+// I/O class: the kernel serves it only when no one else wants the disk.
+// Returns false where the platform or scheduler does not support it.
+bool set_idle_io_priority();
+
+} // namespace analyzer
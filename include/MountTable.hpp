@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace analyzer {
+
+struct MountInfo {
+    fs::path mount_point;
+    std::string fs_type;
+    std::string source;
+    uint64_t device = 0; // major << 32 | minor, as mountinfo reports it
+    bool pseudo = false; // kernel-generated contents (proc, sysfs, ...), nothing on disk
+};
+
+// The mounts of this process, from /proc/self/mountinfo. Lets a scan see
+// that a subdirectory is a mount point from its path alone, without a stat
+// per directory. Empty where mountinfo is unavailable.
+class MountTable {
+public:
+    bool load(const fs::path& mountinfo = "/proc/self/mountinfo");
+
+    const std::vector<MountInfo>& mounts() const { return mounts_; }
+
+    // The mount holding `path`, an absolute canonical path. nullptr if the
+    // table is empty.
+    const MountInfo* mount_of(std::string_view path) const;
+
+    static bool is_pseudo_fs(std::string_view fs_type);
+
+private:
+    std::vector<MountInfo> mounts_; // in mount order; later entries shadow earlier ones
+};
+
+} // namespace analyzer
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace analyzer {
+
+#ifdef __linux__
+inline constexpr bool kNativeTraversalSupported = true;
+#else
+inline constexpr bool kNativeTraversalSupported = false;
+#endif
+
+struct RawDirEntry {
+    std::string_view name;  // points into the reader's buffer, valid until the next refill
+    unsigned char type = 0; // DT_* value from the kernel, DT_UNKNOWN if the FS does not report it
+    uint64_t inode = 0;
+};
+
+// Thin getdents64 wrapper: one open() per directory, entries decoded straight
+// out of a large reusable buffer, no per-entry allocation. Linux only.
+class NativeDirectoryReader {
+public:
+    static constexpr size_t kDefaultBufferSize = 256 * 1024;
+
+    explicit NativeDirectoryReader(size_t buffer_size = kDefaultBufferSize);
+    ~NativeDirectoryReader();
+
+    NativeDirectoryReader(const NativeDirectoryReader&) = delete;
+    NativeDirectoryReader& operator=(const NativeDirectoryReader&) = delete;
+
+    // Opens `name` relative to `parent_fd` (AT_FDCWD for plain paths). A
+    // symlink in its last component is refused unless `follow_symlinks`.
+    bool open(int parent_fd, const char* name, std::error_code& ec, bool follow_symlinks = false);
+    // Returns false at end of directory or on error (ec set).
+    bool next(RawDirEntry& entry, std::error_code& ec);
+    void close();
+    // Hands the open directory over to the caller, who must close it.
+    int release();
+
+    int fd() const { return fd_; }
+    // Bytes getdents64 returned since open().
+    uint64_t bytes_read() const { return bytes_read_; }
+
+private:
+    bool refill(std::error_code& ec);
+
+    std::vector<char> buffer_;
+    size_t offset_ = 0;
+    size_t length_ = 0;
+    uint64_t bytes_read_ = 0;
+    int fd_ = -1;
+};
+
+// A directory kept open after its scan so its subdirectories can be opened
+// by name relative to it, instead of the kernel walking their full paths
+// again. Shared by the parent's subdirectory tasks, closed with the last.
+class DirectoryHandle {
+public:
+    explicit DirectoryHandle(int fd); // takes ownership
+    ~DirectoryHandle();
+
+    DirectoryHandle(const DirectoryHandle&) = delete;
+    DirectoryHandle& operator=(const DirectoryHandle&) = delete;
+
+    int fd() const { return fd_; }
+
+    // False once the handles kept open take half the process's descriptor
+    // limit (a level-by-level sampled scan queues whole levels); further
+    // directories are then opened by full path.
+    static bool available();
+
+private:
+    int fd_;
+    static std::atomic<size_t> open_;
+};
+
+} // namespace analyzer
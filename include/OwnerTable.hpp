@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace analyzer {
+
+// Files and bytes per numeric owner, one table for uids and one for gids.
+// Ids below kDenseIds index a flat array directly, so counting a file is
+// one bounds check and three additions; that range holds the ids of nearly
+// every real system. Larger ids (directory services, idmapped mounts) go
+// to a map. Not thread-safe: each worker owns one, like ExtensionTable.
+class OwnerTable {
+public:
+    static constexpr uint32_t kDenseIds = 65536;
+
+    struct Usage {
+        uint64_t files = 0;
+        uint64_t size = 0;
+        uint64_t allocated_size = 0;
+    };
+
+    void add(uint32_t id, uint64_t size, uint64_t allocated_size) {
+        Usage& usage = id < dense_.size() ? dense_[id] : slot(id);
+        usage.files++;
+        usage.size += size;
+        usage.allocated_size += allocated_size;
+    }
+    void remove(uint32_t id, uint64_t size, uint64_t allocated_size);
+    // Adds pre-aggregated totals, e.g. from a cache record or shard state.
+    void add_totals(uint32_t id, const Usage& usage);
+    void merge(const OwnerTable& other);
+    // Multiplies every count and size by `weight`, rounding to whole files and bytes.
+    void scale(double weight);
+
+    // Calls f(id, usage) for every id with at least one file, dense ids first.
+    template <typename F>
+    void for_each(F&& f) const {
+        for (uint32_t id = 0; id < dense_.size(); ++id) {
+            if (dense_[id].files != 0) f(id, dense_[id]);
+        }
+        for (const auto& [id, usage] : sparse_) {
+            if (usage.files != 0) f(id, usage);
+        }
+    }
+
+private:
+    Usage& slot(uint32_t id); // grows the array, or falls back to the map
+
+    std::vector<Usage> dense_;
+    std::unordered_map<uint32_t, Usage> sparse_;
+};
+
+// Account and group names, looked up once per id for the life of the
+// process and shared by all threads. Ids without a name come back as the
+// number itself.
+std::string user_name(uint32_t uid);
+std::string group_name(uint32_t gid);
+
+} // namespace analyzer
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace analyzer {
+
+// A set of glob patterns, matched as a whole: true if any pattern matches.
+//
+// `*` and `?` match within one path component, `[a-z]` / `[!a-z]` one
+// character of a class, `**` any number of components, and `\` escapes the
+// next character. A pattern without a slash matches the entry name at any
+// depth ("node_modules", "*.o"); one with a slash matches the path relative
+// to the set's base directory ("build/*/obj", "/vendor"). A trailing slash
+// marks a directory-only pattern; GlobSet ignores it and leaves keeping
+// such patterns apart to its users.
+//
+// Most real patterns are a plain name or a "*.ext" suffix. Those are
+// answered by hash lookups however many there are; only the rest are run
+// through the glob matcher. Immutable once built, so shared by all workers.
+class GlobSet {
+public:
+    static bool is_directory_pattern(std::string_view pattern) { return pattern.size() > 1 && pattern.back() == '/'; }
+
+    // Returns false, adding nothing, if the pattern is empty.
+    bool add(std::string_view pattern);
+    bool empty() const { return count_ == 0; }
+
+    // `dir` is the entry's parent relative to the base directory, "" for the base itself.
+    bool matches(std::string_view dir, std::string_view name) const;
+
+private:
+    struct Token {
+        enum Kind : uint8_t { Literal, Any, Star, Class } kind = Literal;
+        char c = 0;
+        std::bitset<256> set; // Class only
+    };
+
+    struct Segment {
+        bool any_depth = false; // "**"
+        std::vector<Token> tokens;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+    using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+
+    static std::vector<Segment> compile(std::string_view pattern, bool& anchored);
+    static bool match_component(const std::vector<Token>& tokens, std::string_view text);
+    static bool match_path(const std::vector<Segment>& segments, const std::vector<std::string_view>& components);
+
+    size_t count_ = 0;
+    StringSet names_;      // "node_modules"
+    StringSet extensions_; // "*.o", stored as ".o"
+    std::vector<std::string> suffixes_;
+    std::vector<std::string> prefixes_;
+    std::vector<std::vector<Token>> name_globs_;
+    std::vector<std::vector<Segment>> path_globs_;
+};
+
+// Include/exclude patterns (GlobSet syntax) relative to the scan root.
+// Exclusions apply to files and directories alike, and an excluded directory
+// is pruned before it is opened. Inclusions, if any, select files only;
+// directories are still descended.
+class PathMatcher {
+public:
+    PathMatcher() = default;
+    PathMatcher(const std::vector<std::string>& include, const std::vector<std::string>& exclude);
+
+    bool empty() const { return !filters_files_ && !filters_directories_; }
+
+    // `dir` is the entry's parent relative to the scan root, "" for the root itself.
+    bool excludes_directory(std::string_view dir, std::string_view name) const {
+        return filters_directories_ && (exclude_.matches(dir, name) || exclude_directories_.matches(dir, name));
+    }
+    bool accepts_file(std::string_view dir, std::string_view name) const {
+        if (!filters_files_) return true;
+        return !exclude_.matches(dir, name) && (include_.empty() || include_.matches(dir, name));
+    }
+
+private:
+    GlobSet include_;
+    GlobSet exclude_;
+    GlobSet exclude_directories_; // trailing-slash exclusions
+    bool filters_files_ = false;
+    bool filters_directories_ = false;
+};
+
+} // namespace analyzer
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "DuplicateFinder.hpp"
 #include "FileSystemAnalyzer.hpp"
+#include "Inventory.hpp"
 #include "LogAnalyzer.hpp"
 #include <string>
 
@@ -12,20 +14,27 @@ public:
     
     virtual std::string generate_fs_report(const DirectoryStats& stats) const = 0;
     virtual std::string generate_log_report(const LogSummary& summary) const = 0;
+    virtual std::string generate_dup_report(const DuplicateReport& report) const = 0;
+    virtual std::string generate_diff_report(const InventoryDiff& diff) const = 0;
 };
 
 class TextReportGenerator : public ReportGenerator {
 public:
     std::string generate_fs_report(const DirectoryStats& stats) const override;
     std::string generate_log_report(const LogSummary& summary) const override;
+    std::string generate_dup_report(const DuplicateReport& report) const override;
+    std::string generate_diff_report(const InventoryDiff& diff) const override;
 private:
     std::string format_size(uint64_t bytes) const;
+    std::string format_change(uint64_t old_size, uint64_t new_size) const; // signed, e.g. "+1.50 MB"
 };
 
 class JsonReportGenerator : public ReportGenerator {
 public:
     std::string generate_fs_report(const DirectoryStats& stats) const override;
     std::string generate_log_report(const LogSummary& summary) const override;
+    std::string generate_dup_report(const DuplicateReport& report) const override;
+    std::string generate_diff_report(const InventoryDiff& diff) const override;
 };
 
 } // namespace analyzer
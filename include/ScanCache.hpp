@@ -0,0 +1,102 @@
+#pragma once
+
+#include "FileSystemAnalyzer.hpp"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace analyzer {
+
+struct CachedFile {
+    std::string name;
+    uint64_t size = 0;
+    uint64_t allocated_size = 0;
+    int64_t mtime = 0;
+    int64_t atime = 0;
+    int64_t ctime = 0;
+};
+
+struct CachedExtension {
+    std::string extension;
+    uint64_t count = 0;
+    uint64_t size = 0;
+    std::vector<uint64_t> histogram; // non-empty SizeHistogram buckets as (index, count) pairs
+    uint64_t smallest = 0;           // the histogram's recorded bounds
+    uint64_t largest = 0;
+};
+
+// A regular file as it was last read. Rewriting a file in place does not
+// touch its directory's mtime, so each is stat'ed again before the record
+// is replayed; any difference, ctime included, means a rescan.
+struct CachedFileStat {
+    std::string name;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    int64_t ctime = 0;
+};
+
+// What one directory contributed to the last scan, minus its subdirectories.
+// Kept flat rather than as a DirectoryStats: millions of these live in memory.
+struct CachedDirectory {
+    int64_t mtime = 0; // directory mtime when this record was taken
+    uint64_t total_files = 0;
+    uint64_t total_directories = 0;
+    uint64_t total_size = 0;
+    uint64_t total_allocated_size = 0;
+    std::vector<CachedExtension> extensions;
+    std::vector<uint64_t> size_histogram;
+    std::vector<uint64_t> age_distribution;
+    std::vector<uint64_t> users;          // (uid, files, size, allocated size) per owner, with owner usage
+    std::vector<uint64_t> groups;         // likewise per gid
+    std::vector<CachedFile> top_files;    // union of the directory's top lists
+    std::vector<std::string> subdirs;     // immediate subdirectory names
+    std::vector<int64_t> recent_mtimes;   // files not yet in the last age bucket, re-bucketed on reuse
+    std::vector<CachedFileStat> files;    // every regular file read, counted or not
+    bool seen = false;                    // visited during the current scan, kept on save
+};
+
+// Persistent per-directory cache keyed by (dev, inode). A directory whose
+// mtime still matches, and whose files all stat as recorded, is replayed
+// from its record without reading its entries. The file is a stream of
+// length-prefixed records, read and written one at a time, so no more than
+// one record is ever held in a second form.
+class ScanCache {
+public:
+    explicit ScanCache(std::string fingerprint);
+
+    // A missing file, a format mismatch or a different fingerprint (scan
+    // options) all yield an empty cache, i.e. a full scan.
+    void load(const fs::path& file);
+    // Records not looked up this run are dropped as deleted, unless
+    // keep_unseen (a scan that stopped early did not look everywhere).
+    bool save(const fs::path& file, bool keep_unseen = false) const;
+
+    // Thread-safe. The returned record stays valid for the cache's lifetime.
+    const CachedDirectory* lookup(uint64_t device, uint64_t inode, int64_t mtime);
+    // A record lookup() returned turned out stale after all: counts as a miss.
+    void reject();
+    void store(uint64_t device, uint64_t inode, CachedDirectory record);
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    struct Key {
+        uint64_t device;
+        uint64_t inode;
+        bool operator==(const Key&) const = default;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return std::hash<uint64_t>{}(key.inode * 0x9E3779B97F4A7C15ull ^ key.device); }
+    };
+
+    std::string fingerprint_;
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, CachedDirectory, KeyHash> directories_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+} // namespace analyzer
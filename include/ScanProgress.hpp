@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace analyzer {
+
+// Live counters of a running scan. Every scanning thread gets counters of
+// its own, on their own cache line, and adds to them with relaxed atomics
+// once per directory; nothing is shared on the hot path. Readers sum the
+// threads' counters whenever they like.
+class ScanProgress {
+public:
+    struct Snapshot {
+        uint64_t directories = 0;
+        uint64_t files = 0;
+        uint64_t size = 0;
+        uint64_t errors = 0; // entries and directories that could not be read
+    };
+
+    ScanProgress();
+
+    // One directory done, holding `files` counted files of `size` bytes and
+    // `errors` entries that could not be read.
+    void add_directory(uint64_t files, uint64_t size, uint64_t errors) {
+        Counters& counters = local();
+        counters.directories.fetch_add(1, std::memory_order_relaxed);
+        counters.files.fetch_add(files, std::memory_order_relaxed);
+        counters.size.fetch_add(size, std::memory_order_relaxed);
+        if (errors != 0) counters.errors.fetch_add(errors, std::memory_order_relaxed);
+    }
+
+    Snapshot total() const;
+
+private:
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> directories{0};
+        std::atomic<uint64_t> files{0};
+        std::atomic<uint64_t> size{0};
+        std::atomic<uint64_t> errors{0};
+    };
+
+    Counters& local();
+    Counters& add_thread();
+
+    const uint64_t id_; // tells instances apart in the per-thread lookup
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Counters>> threads_;
+};
+
+// What a finished scan of one target took, kept between runs for the ETA
+// of the next one. Stored under $XDG_CACHE_HOME (or ~/.cache).
+struct ScanRecord {
+    uint64_t directories = 0;
+    uint64_t files = 0;
+    uint64_t size = 0;
+    double seconds = 0;
+};
+
+// `key` names the target and everything that changes what a scan reads.
+std::optional<ScanRecord> load_scan_record(const std::string& key);
+void save_scan_record(const std::string& key, const ScanRecord& record);
+
+// Prints a progress line to stderr every `interval` until stopped: counts,
+// current rate, errors and, given the last run's totals, an ETA. On a
+// terminal the line is rewritten in place, elsewhere one line is appended
+// per interval.
+class ProgressReporter {
+public:
+    ProgressReporter(const ScanProgress& progress, std::chrono::seconds interval,
+                     std::optional<ScanRecord> previous = std::nullopt);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    // Stops the thread and clears the line. Idempotent.
+    void stop();
+
+private:
+    void run();
+    std::string line(const ScanProgress::Snapshot& now, const ScanProgress::Snapshot& last, double elapsed,
+                     double interval) const;
+
+    const ScanProgress& progress_;
+    std::chrono::seconds interval_;
+    std::optional<ScanRecord> previous_;
+    bool terminal_ = false;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace analyzer
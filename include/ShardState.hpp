@@ -0,0 +1,31 @@
+#pragma once
+
+#include "FileSystemAnalyzer.hpp"
+#include <string>
+#include <vector>
+
+namespace analyzer {
+
+// What one `fs --shard=i/n` process found, saved for `merge`. The stats are
+// kept in their mergeable form (extension table, top-file heaps) rather
+// than just the report lists, so merged percentiles and rankings come out
+// as a single-process scan would have them.
+struct ShardState {
+    std::string target;     // scanned directory, as given
+    unsigned shard_index = 0;
+    unsigned shard_count = 1;
+    std::string settings;   // FileSystemAnalyzer::fingerprint(); must agree between shards
+    DirectoryStats stats;   // as analyze() returned it
+};
+
+bool save_shard_state(const fs::path& file, const ShardState& state);
+// Returns false, with a warning, for a missing, unreadable or foreign file.
+bool load_shard_state(const fs::path& file, ShardState& state);
+
+// Combines the shards of one scan into finalized stats. States from another
+// scan (target, shard count or settings differ) and repeated shards are
+// skipped with a warning; missing shards are reported, and the result then
+// covers only the shards present.
+DirectoryStats merge_shard_states(const std::vector<ShardState>& states);
+
+} // namespace analyzer
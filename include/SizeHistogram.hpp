@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace analyzer {
+
+// File size percentiles read off a SizeHistogram, in bytes.
+struct SizePercentiles {
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+};
+
+// HDR-style log-linear histogram of file sizes. Each power of two is split
+// into 2^precision equal sub-buckets, so any recorded size is known to
+// within 2^-precision of its value (values below 2^precision exactly). The
+// bucket index is computed from one bit scan, no search. Memory is bounded
+// by the bucket count, (65 - precision) << precision, whatever the number
+// of files; counts grow only up to the largest bucket actually used.
+class SizeHistogram {
+public:
+    static constexpr unsigned kDefaultPrecision = 3;
+    static constexpr unsigned kMaxPrecision = 8;
+
+    explicit SizeHistogram(unsigned precision = kDefaultPrecision);
+
+    unsigned precision() const { return precision_; }
+    uint64_t total() const { return total_; }
+
+    void add(uint64_t size) {
+        count(bucket_of(size), 1);
+        smallest_ = std::min(smallest_, size);
+        largest_ = std::max(largest_, size);
+    }
+    // Removing a file leaves the bounds as they were unless the histogram
+    // empties: they stay true bounds, if looser ones.
+    void remove(uint64_t size);
+    void merge(const SizeHistogram& other);
+    // Multiplies every count by `weight`, rounding each bucket, for
+    // extrapolating a sample.
+    void scale(double weight);
+
+    // Smallest recorded size such that `percent` % of the files are no
+    // larger, reported as the middle of its bucket clamped to the smallest
+    // and largest sizes recorded. 0 when empty.
+    uint64_t percentile(double percent) const;
+    SizePercentiles percentiles() const { return {percentile(50), percentile(90), percentile(99)}; }
+
+    // Bounds of the sizes recorded; smallest() > largest() when empty.
+    uint64_t smallest() const { return smallest_; }
+    uint64_t largest() const { return largest_; }
+
+    // Raw bucket access, used to persist histograms in the scan cache.
+    // add_bucket() widens the bounds to the whole bucket; restore() then
+    // narrows them back to the bounds saved alongside.
+    size_t bucket_count() const { return counts_.size(); }
+    uint64_t bucket(size_t index) const { return counts_[index]; }
+    void add_bucket(size_t index, uint64_t count);
+    void restore(uint64_t smallest, uint64_t largest);
+
+    size_t bucket_of(uint64_t size) const;
+    uint64_t lowest_in_bucket(size_t index) const;
+    uint64_t highest_in_bucket(size_t index) const;
+
+private:
+    void count(size_t index, uint64_t count);
+
+    unsigned precision_;
+    uint64_t total_ = 0;
+    uint64_t smallest_ = std::numeric_limits<uint64_t>::max();
+    uint64_t largest_ = 0;
+    std::vector<uint64_t> counts_;
+};
+
+} // namespace analyzer
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace analyzer {
+
+struct FileEntry;
+
+enum class Ranking : unsigned {
+    Largest,         // size, largest first
+    Oldest,          // mtime, oldest first
+    Newest,          // mtime, newest first
+    LeastAccessed,   // atime, least recently accessed first
+    RecentlyChanged, // ctime, most recently changed first
+};
+
+inline constexpr size_t kRankingCount = 5;
+
+constexpr unsigned ranking_bit(Ranking ranking) { return 1u << static_cast<unsigned>(ranking); }
+
+inline constexpr unsigned kDefaultRankings =
+    ranking_bit(Ranking::Largest) | ranking_bit(Ranking::Oldest) | ranking_bit(Ranking::Newest);
+
+// What a ranking looks at, i.e. a FileEntry minus its strings.
+struct RankedAttributes {
+    uint64_t size = 0;
+    uint64_t allocated_size = 0;
+    fs::file_time_type last_modified{};
+    fs::file_time_type last_accessed{};
+    fs::file_time_type last_changed{};
+};
+
+// Bounded "top N files" for several rankings at once. Each ranking keeps a
+// heap of compact records with its worst entry on top, so a file that does
+// not beat it is turned away after one integer compare and nothing is
+// copied. Paths of the records that make it in are appended to a
+// per-ranking arena, compacted once evicted paths dominate it. Ties are
+// broken by path so the outcome does not depend on scan or merge order.
+// Not thread-safe: each worker owns one.
+class TopFiles {
+public:
+    TopFiles() = default;
+    TopFiles(size_t capacity, unsigned rankings);
+
+    size_t capacity() const { return capacity_; }
+    unsigned rankings() const { return rankings_; }
+    bool tracks(Ranking ranking) const { return (rankings_ & ranking_bit(ranking)) != 0; }
+
+    void offer(std::string_view path, const RankedAttributes& attributes);
+    // Drops `path` from every ranking; returns true if it was in any. The
+    // freed places are not refilled, the caller has to offer again.
+    bool remove(std::string_view path);
+    void merge(const TopFiles& other);
+    void clear();
+
+    // Best first.
+    std::vector<FileEntry> entries(Ranking ranking) const;
+
+    // Calls fn(path, attributes) once per distinct file held by any ranking.
+    template <typename Fn>
+    void for_each_file(Fn&& fn) const;
+
+private:
+    struct Record {
+        int64_t score = 0; // higher ranks better
+        uint64_t path_offset = 0;
+        uint32_t path_length = 0;
+        RankedAttributes attributes;
+    };
+
+    struct List {
+        std::vector<Record> heap;
+        std::string arena;
+
+        std::string_view path(const Record& record) const { return {arena.data() + record.path_offset, record.path_length}; }
+    };
+
+    static int64_t score(Ranking ranking, const RankedAttributes& attributes);
+    static bool better(int64_t score_a, std::string_view path_a, int64_t score_b, std::string_view path_b) {
+        return score_a != score_b ? score_a > score_b : path_a < path_b;
+    }
+    void offer(List& list, int64_t score, std::string_view path, const RankedAttributes& attributes);
+    static void compact(List& list);
+
+    size_t capacity_ = 0;
+    unsigned rankings_ = 0;
+    std::array<List, kRankingCount> lists_;
+};
+
+template <typename Fn>
+void TopFiles::for_each_file(Fn&& fn) const {
+    std::unordered_set<std::string_view> seen;
+    for (const auto& list : lists_) {
+        for (const auto& record : list.heap) {
+            auto path = list.path(record);
+            if (seen.insert(path).second) fn(path, record.attributes);
+        }
+    }
+}
+
+} // namespace analyzer
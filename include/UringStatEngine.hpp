@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FileMetadata.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+namespace analyzer {
+
+// Batched statx on top of a raw io_uring (no liburing dependency). A whole
+// directory's worth of stats is queued at once and kept up to `queue_depth`
+// requests in flight, so on high-latency filesystems the round trips overlap
+// instead of being paid one after another. When the kernel or a seccomp
+// policy refuses io_uring, available() is false and callers use the
+// synchronous read_metadata() path instead.
+class UringStatEngine {
+public:
+    using Completion = std::function<void(size_t index, const FileMetadata& metadata, const std::error_code& ec)>;
+
+    static constexpr unsigned kDefaultQueueDepth = 256;
+
+    explicit UringStatEngine(unsigned queue_depth = kDefaultQueueDepth);
+    ~UringStatEngine();
+
+    UringStatEngine(const UringStatEngine&) = delete;
+    UringStatEngine& operator=(const UringStatEngine&) = delete;
+
+    bool available() const { return ring_fd_ >= 0 && !failed_; }
+
+    // Stats every name relative to dir_fd. Completions arrive in kernel order,
+    // identified by their index in `names`; the names must stay alive until
+    // the call returns.
+    void stat_batch(int dir_fd, const std::vector<const char*>& names, unsigned fields, const Completion& on_complete);
+
+private:
+    struct Ring;
+
+    void stat_sync(int dir_fd, const char* name, size_t index, unsigned fields, const Completion& on_complete);
+
+    int ring_fd_ = -1;
+    bool failed_ = false; // io_uring_enter hit a hard error; stay on the sync path
+    std::unique_ptr<Ring> ring_;
+};
+
+} // namespace analyzer
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace analyzer {
+
+// Fixed-size pool where every worker owns a deque. Workers pop their own
+// newest task (depth-first, cache-friendly) and steal the oldest task from
+// a sibling when they run dry, which keeps big subtrees spread out.
+//
+// Workers can be split into groups that only steal among themselves, so
+// tasks that block (a slow network mount) tie up their own group and no
+// other. A group's threads start with its first task.
+template <typename Task>
+class WorkStealingPool {
+public:
+    using Handler = std::function<void(unsigned worker_id, Task& task)>;
+
+    explicit WorkStealingPool(unsigned worker_count, unsigned group_count = 1)
+        : group_size_(worker_count == 0 ? 1 : worker_count), started_(group_count == 0 ? 1 : group_count) {
+        for (unsigned i = 0; i < group_size_ * started_.size(); ++i) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+    }
+
+    unsigned worker_count() const { return static_cast<unsigned>(queues_.size()); }
+    unsigned group_of(unsigned worker_id) const { return worker_id / group_size_; }
+
+    // Safe to call from inside a handler; the task lands on that worker's deque.
+    void submit(unsigned worker_id, Task task) {
+        worker_id %= worker_count();
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        {
+            auto& queue = *queues_[worker_id];
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        if (handler_ != nullptr) start_group(group_of(worker_id));
+    }
+
+    // Hands the task to another group, spreading submissions over its workers.
+    void submit_to_group(unsigned group, Task task) {
+        unsigned offset = next_in_group_.fetch_add(1, std::memory_order_relaxed) % group_size_;
+        submit(group * group_size_ + offset, std::move(task));
+    }
+
+    // Blocks until every submitted task, including those spawned by handlers, has run.
+    void run(const Handler& handler) {
+        handler_ = &handler;
+        for (unsigned group = 0; group < started_.size(); ++group) {
+            if (has_tasks(group)) start_group(group);
+        }
+        // Groups are started by handlers while their task is still pending,
+        // so once the started threads have drained the pool no more appear.
+        while (true) {
+            std::vector<std::jthread> threads;
+            {
+                std::lock_guard lock(threads_mutex_);
+                threads.swap(threads_);
+            }
+            if (threads.empty()) break;
+        }
+        handler_ = nullptr;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(unsigned id, const Handler& handler) {
+        unsigned idle_rounds = 0;
+        while (true) {
+            Task task;
+            if (pop_local(id, task) || steal(id, task)) {
+                idle_rounds = 0;
+                handler(id, task);
+                // Decrement only after the handler returns so that tasks it
+                // spawned are already counted and the pool cannot drain early.
+                pending_.fetch_sub(1, std::memory_order_acq_rel);
+                continue;
+            }
+            if (pending_.load(std::memory_order_acquire) == 0) return;
+            if (++idle_rounds < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    bool pop_local(unsigned id, Task& out) {
+        auto& queue = *queues_[id];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        out = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thief, Task& out) {
+        const unsigned first = group_of(thief) * group_size_;
+        for (unsigned offset = 1; offset < group_size_; ++offset) {
+            auto& victim = *queues_[first + (thief - first + offset) % group_size_];
+            std::lock_guard lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            out = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    bool has_tasks(unsigned group) {
+        for (unsigned id = group * group_size_; id < (group + 1) * group_size_; ++id) {
+            std::lock_guard lock(queues_[id]->mutex);
+            if (!queues_[id]->tasks.empty()) return true;
+        }
+        return false;
+    }
+
+    void start_group(unsigned group) {
+        if (started_[group].load(std::memory_order_acquire)) return;
+        std::lock_guard lock(threads_mutex_);
+        if (started_[group].exchange(true, std::memory_order_acq_rel)) return;
+        for (unsigned id = group * group_size_; id < (group + 1) * group_size_; ++id) {
+            threads_.emplace_back([this, id] { worker_loop(id, *handler_); });
+        }
+    }
+
+    unsigned group_size_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::atomic<bool>> started_; // per group
+    std::atomic<uint64_t> pending_{0};
+    std::atomic<unsigned> next_in_group_{0};
+    const Handler* handler_ = nullptr; // set while run() is active
+    std::mutex threads_mutex_;
+    std::vector<std::jthread> threads_;
+};
+
+} // namespace analyzer
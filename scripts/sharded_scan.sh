@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Scans <dir> with <shards> parallel `fs --shard` processes and prints the
+# merged report. Remaining arguments are passed to every shard (and --json
+# to the merge as well). The binary is taken from $FSA, default
+# ./FileStatAnalyzer.
+#
+#   scripts/sharded_scan.sh /data 8 --threads=4 --json
+set -euo pipefail
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <dir> <shards> [fs options]" >&2
+    exit 1
+fi
+
+dir=$1
+shards=$2
+shift 2
+fsa=${FSA:-./FileStatAnalyzer}
+
+merge_options=()
+for option in "$@"; do
+    [ "$option" = "--json" ] && merge_options+=(--json)
+done
+
+workdir=$(mktemp -d)
+trap 'rm -rf "$workdir"' EXIT
+
+pids=()
+for ((i = 0; i < shards; i++)); do
+    "$fsa" fs "$dir" "--shard=$i/$shards" "--state=$workdir/shard-$i.state" "$@" &
+    pids+=($!)
+done
+
+# Exit 2 is a shard stopped by --time-limit or a signal: its state is
+# partial but still merged, and the merge then exits 2 as well.
+failed=0
+for i in "${!pids[@]}"; do
+    status=0
+    wait "${pids[$i]}" || status=$?
+    if [ "$status" -ne 0 ] && [ "$status" -ne 2 ]; then
+        echo "Shard $i/$shards failed" >&2
+        failed=1
+    fi
+done
+[ "$failed" -eq 0 ] || exit 1
+
+states=()
+for ((i = 0; i < shards; i++)); do
+    states+=("$workdir/shard-$i.state")
+done
+# Before bash 4.4, set -u treats an empty array as unbound.
+"$fsa" merge "${states[@]}" ${merge_options[@]+"${merge_options[@]}"}
@@ -0,0 +1,244 @@
+#include "DirectoryTree.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+
+namespace analyzer {
+
+namespace {
+
+// The order top() sorts in, for the streaming rankings.
+template <typename Key>
+bool ranks_ahead(const DirectorySummary& a, const DirectorySummary& b, Key key) {
+    if (key(a) != key(b)) return key(a) > key(b);
+    return a.path < b.path;
+}
+
+template <typename Key>
+std::vector<DirectorySummary> ranked(std::vector<DirectorySummary> ranking, size_t n, Key key) {
+    std::sort(ranking.begin(), ranking.end(),
+              [key](const DirectorySummary& a, const DirectorySummary& b) { return ranks_ahead(a, b, key); });
+    if (ranking.size() > n) ranking.resize(n);
+    return ranking;
+}
+
+} // namespace
+
+void DirectoryTree::stream(size_t n) {
+    std::lock_guard lock(mutex_);
+    streaming_ = true;
+    keep_ = n;
+}
+
+DirectoryTree::NodeId DirectoryTree::append(NodeId parent, std::string&& name) {
+    Node node;
+    node.parent = parent;
+    if (streaming_) {
+        if (!free_.empty()) {
+            const NodeId id = free_.back();
+            free_.pop_back();
+            nodes_[id] = node;
+            node_names_[id] = std::move(name);
+            pending_[id] = 1;
+            return id;
+        }
+        node_names_.push_back(std::move(name));
+        pending_.push_back(1);
+    } else {
+        node.name_offset = names_.size();
+        names_.append(name);
+        names_.push_back('\0');
+    }
+    nodes_.push_back(node);
+    return static_cast<NodeId>(nodes_.size() - 1);
+}
+
+const char* DirectoryTree::name(NodeId node) const {
+    return streaming_ ? node_names_[node].c_str() : names_.data() + nodes_[node].name_offset;
+}
+
+DirectoryTree::NodeId DirectoryTree::add_root(const fs::path& path) {
+    std::lock_guard lock(mutex_);
+    nodes_.clear();
+    names_.clear();
+    node_names_.clear();
+    pending_.clear();
+    free_.clear();
+    largest_.clear();
+    most_populated_.clear();
+    sample_rates_.clear();
+    root_variance_ = {};
+    return append(kNoParent, path.string());
+}
+
+void DirectoryTree::record(NodeId node, uint64_t files, uint64_t size, uint64_t allocated_size,
+                           std::vector<DirectoryTask>& subdirs) {
+    // Every worker records every directory, so the names are built before
+    // taking the lock, which then only copies them in.
+    std::vector<std::string> names;
+    names.reserve(subdirs.size());
+    for (const auto& subdir : subdirs) names.push_back(subdir.path.filename().string());
+
+    std::lock_guard lock(mutex_);
+    Node& self = nodes_[node];
+    self.files += files;
+    self.size += size;
+    self.allocated_size += allocated_size;
+    for (size_t i = 0; i < subdirs.size(); ++i) subdirs[i].node = append(node, std::move(names[i]));
+    if (streaming_) {
+        pending_[node] += static_cast<uint32_t>(subdirs.size());
+        finish(node);
+    }
+}
+
+void DirectoryTree::finish(NodeId node) {
+    // Completing a directory can complete its parent in turn, up to the
+    // first ancestor with subdirectories still outstanding.
+    while (--pending_[node] == 0) {
+        const Node done = nodes_[node];
+        if (done.parent == kNoParent) return; // the root keeps the scan totals
+        offer(largest_, node, [](const auto& entry) { return entry.size; });
+        offer(most_populated_, node, [](const auto& entry) { return entry.files; });
+
+        Node& parent = nodes_[done.parent];
+        parent.files += done.files;
+        parent.size += done.size;
+        parent.allocated_size += done.allocated_size;
+        node_names_[node].clear();
+        free_.push_back(node);
+        node = done.parent;
+    }
+}
+
+template <typename Key>
+void DirectoryTree::offer(std::vector<DirectorySummary>& ranking, NodeId node, Key key) {
+    if (keep_ == 0) return;
+    const Node& entry = nodes_[node];
+    // Most directories lose to the current last place on the key alone,
+    // before their path is ever built.
+    if (ranking.size() == keep_ && key(entry) < key(ranking.front())) return;
+
+    DirectorySummary summary{path(node), entry.files, entry.size, entry.allocated_size};
+    auto ahead = [key](const DirectorySummary& a, const DirectorySummary& b) { return ranks_ahead(a, b, key); };
+    if (ranking.size() == keep_) {
+        if (!ahead(summary, ranking.front())) return;
+        std::pop_heap(ranking.begin(), ranking.end(), ahead);
+        ranking.back() = std::move(summary);
+    } else {
+        ranking.push_back(std::move(summary));
+    }
+    std::push_heap(ranking.begin(), ranking.end(), ahead);
+}
+
+void DirectoryTree::sample(std::vector<double> rates) {
+    sample_rates_ = std::move(rates);
+}
+
+void DirectoryTree::roll_up() {
+    if (streaming_) return;
+    if (!sample_rates_.empty()) {
+        roll_up_sampled();
+        return;
+    }
+    for (size_t i = nodes_.size(); i-- > 1;) {
+        Node& parent = nodes_[nodes_[i].parent];
+        parent.files += nodes_[i].files;
+        parent.size += nodes_[i].size;
+        parent.allocated_size += nodes_[i].allocated_size;
+    }
+}
+
+void DirectoryTree::roll_up_sampled() {
+    struct Estimate {
+        double files = 0, size = 0, allocated_size = 0;
+        double files_variance = 0, size_variance = 0;
+    };
+    std::vector<Estimate> estimates(nodes_.size());
+    std::vector<uint32_t> depth(nodes_.size(), 0);
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        const Node& node = nodes_[i];
+        if (i > 0) depth[i] = depth[node.parent] + 1;
+        estimates[i] = {static_cast<double>(node.files), static_cast<double>(node.size),
+                        static_cast<double>(node.allocated_size), 0, 0};
+    }
+
+    // A child scanned with probability p stands for 1/p like it. Its share
+    // of the variance is the sampling of the child itself, (1 - p) T^2 / p^2,
+    // plus its own estimate's variance, V / p, both estimated from the
+    // children that were scanned. Directories that were queued but never
+    // scanned estimate zero, which the rate of their level accounts for.
+    for (size_t i = nodes_.size(); i-- > 1;) {
+        const double p = depth[i] < sample_rates_.size() ? sample_rates_[depth[i]] : 1.0;
+        const Estimate& child = estimates[i];
+        Estimate& parent = estimates[nodes_[i].parent];
+        parent.files += child.files / p;
+        parent.size += child.size / p;
+        parent.allocated_size += child.allocated_size / p;
+        parent.files_variance += ((1 - p) * child.files * child.files + p * child.files_variance) / (p * p);
+        parent.size_variance += ((1 - p) * child.size * child.size + p * child.size_variance) / (p * p);
+    }
+
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        nodes_[i].files = static_cast<uint64_t>(std::llround(estimates[i].files));
+        nodes_[i].size = static_cast<uint64_t>(std::llround(estimates[i].size));
+        nodes_[i].allocated_size = static_cast<uint64_t>(std::llround(estimates[i].allocated_size));
+    }
+    root_variance_ = {estimates[0].files_variance, estimates[0].size_variance};
+}
+
+fs::path DirectoryTree::path(NodeId node) const {
+    std::vector<const char*> names;
+    for (; node != kNoParent; node = nodes_[node].parent) names.push_back(name(node));
+    fs::path result;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) result /= *it;
+    return result;
+}
+
+template <typename Key>
+std::vector<DirectorySummary> DirectoryTree::top(size_t n, Key key) const {
+    if (nodes_.size() < 2) return {};
+    std::vector<NodeId> ids(nodes_.size() - 1);
+    std::iota(ids.begin(), ids.end(), NodeId{1}); // the root is the whole scan; leave it out
+    n = std::min(n, ids.size());
+    if (n == 0) return {};
+
+    // Selected by key alone: paths are rebuilt from the arena, far too
+    // costly per comparison when many directories tie (empty ones). Node
+    // ids depend on scan order, so ties with the n-th key then go by path,
+    // each built once, so parallel runs agree.
+    std::nth_element(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(n - 1), ids.end(),
+                     [&](NodeId a, NodeId b) { return key(nodes_[a]) > key(nodes_[b]); });
+    const auto boundary = key(nodes_[ids[n - 1]]);
+
+    std::vector<DirectorySummary> result;
+    std::vector<DirectorySummary> tied;
+    for (NodeId id = 1; id < nodes_.size(); ++id) {
+        const Node& node = nodes_[id];
+        if (key(node) < boundary) continue;
+        auto& list = key(node) > boundary ? result : tied;
+        list.push_back({path(id), node.files, node.size, node.allocated_size});
+    }
+    const size_t places = n - result.size();
+    std::partial_sort(tied.begin(), tied.begin() + static_cast<std::ptrdiff_t>(places), tied.end(),
+                      [](const DirectorySummary& a, const DirectorySummary& b) { return a.path < b.path; });
+    result.insert(result.end(), std::make_move_iterator(tied.begin()),
+                  std::make_move_iterator(tied.begin() + static_cast<std::ptrdiff_t>(places)));
+    std::sort(result.begin(), result.end(), [&](const DirectorySummary& a, const DirectorySummary& b) {
+        if (key(a) != key(b)) return key(a) > key(b);
+        return a.path < b.path;
+    });
+    return result;
+}
+
+std::vector<DirectorySummary> DirectoryTree::largest(size_t n) const {
+    auto key = [](const auto& entry) { return entry.size; };
+    return streaming_ ? ranked(largest_, n, key) : top(n, key);
+}
+
+std::vector<DirectorySummary> DirectoryTree::most_populated(size_t n) const {
+    auto key = [](const auto& entry) { return entry.files; };
+    return streaming_ ? ranked(most_populated_, n, key) : top(n, key);
+}
+
+} // namespace analyzer
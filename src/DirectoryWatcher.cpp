@@ -0,0 +1,368 @@
+#include "DirectoryWatcher.hpp"
+#include "IgnoreRules.hpp"
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace analyzer {
+
+namespace {
+
+#ifdef __linux__
+constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW;
+#endif
+
+// Reserve depth per report place, and a floor for short top lists.
+constexpr size_t kReserveFactor = 4;
+constexpr size_t kMinReserve = 64;
+
+RankedAttributes ranked(const FileEntry& entry) {
+    RankedAttributes attributes;
+    attributes.size = entry.size;
+    attributes.allocated_size = entry.allocated_size;
+    attributes.last_modified = entry.last_modified;
+    attributes.last_accessed = entry.last_accessed;
+    attributes.last_changed = entry.last_changed;
+    return attributes;
+}
+
+// Keys of `index` strictly below directory `dir`: '0' follows '/'.
+template <typename Map>
+std::pair<typename Map::iterator, typename Map::iterator> subtree_range(Map& index, const std::string& dir) {
+    return {index.lower_bound(dir + "/"), index.lower_bound(dir + "0")};
+}
+
+} // namespace
+
+DirectoryWatcher::DirectoryWatcher(AnalysisOptions options)
+    : options_(std::move(options)), analyzer_(scan_options(options_.target_path, 0)) {
+    // Replayed directories do not report their files, which the index needs.
+    options_.cache_path.clear();
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+#ifdef __linux__
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+#endif
+}
+
+AnalysisOptions DirectoryWatcher::scan_options(const fs::path& root, int base_depth,
+                                               std::shared_ptr<const IgnoreFrame> ignore) {
+    AnalysisOptions options = options_;
+    options.target_path = root;
+    options.pattern_root = options_.target_path;
+    options.ignore_base = std::move(ignore);
+    if (options.max_depth != -1) options.max_depth -= base_depth;
+    // A rewritten file comes back with the same inode, which hard-link dedup
+    // would then skip; the index tracks every path on its own instead.
+    options.count_hard_links = true;
+    options.on_file = [this](const FileEntry& entry, const FileMetadata&) {
+        std::lock_guard lock(index_mutex_);
+        files_[entry.path.string()] = entry;
+        reserve_.offer(entry.path.native(), ranked(entry));
+    };
+    options.on_directory = [this, base_depth](const DirectoryTask& task) {
+        on_directory(task.path, base_depth + task.depth, task.ignore);
+    };
+    return options;
+}
+
+#ifdef __linux__
+
+bool DirectoryWatcher::run(std::chrono::milliseconds interval, const ReportCallback& report) {
+    full_scan();
+    if (inotify_fd_ < 0) return false;
+
+    auto publish = [&] {
+        refresh_ages();
+        DirectoryStats snapshot = stats_;
+        snapshot.mounts.clear(); // not maintained from events
+        snapshot.finalize();
+        report(snapshot);
+    };
+    publish();
+
+    auto next_report = std::chrono::steady_clock::now() + interval;
+    while (!stop_requested_) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_report - std::chrono::steady_clock::now());
+        pollfd pfd{inotify_fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, static_cast<int>(std::max<int64_t>(0, wait.count())));
+        if (ready > 0) read_events();
+
+        if (std::chrono::steady_clock::now() >= next_report) {
+            apply_changes();
+            publish();
+            next_report += interval;
+        }
+    }
+    return true;
+}
+
+void DirectoryWatcher::full_scan() {
+    // Closing the descriptor drops every watch at once.
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        std::cerr << "Error: inotify unavailable: " << std::generic_category().message(errno) << std::endl;
+        return;
+    }
+
+    files_.clear();
+    directories_.clear();
+    watch_paths_.clear();
+    dirty_.clear();
+    overflowed_ = false;
+    top_lists_stale_ = false;
+    watch_limit_warned_ = false;
+    const size_t reserve = std::max(options_.top_count * kReserveFactor, options_.top_count + kMinReserve);
+    reserve_ = TopFiles(reserve, options_.rankings);
+    reserve_removals_ = 0;
+
+    FileSystemAnalyzer scanner(scan_options(options_.target_path, 0));
+    stats_ = scanner.analyze();
+    // Not maintained from events; better absent than silently stale.
+    stats_.largest_directories.clear();
+    stats_.most_populated_directories.clear();
+    analyzer_.reset_clock();
+    recount_ages();
+}
+
+void DirectoryWatcher::on_directory(const fs::path& path, int depth, std::shared_ptr<const IgnoreFrame> ignore) {
+    WatchedDirectory dir;
+    dir.depth = depth;
+    dir.ignore = std::move(ignore);
+
+    FileMetadata metadata;
+    std::error_code ec;
+    if (read_metadata(kCurrentDirFd, path.c_str(), kFieldInode, metadata, ec)) dir.inode = metadata.inode;
+
+    // Directories below max_depth are counted by their parent but never read,
+    // so they only need to be known, not watched.
+    if (options_.max_depth == -1 || depth <= options_.max_depth) {
+        dir.wd = ::inotify_add_watch(inotify_fd_, path.c_str(), kWatchMask);
+        if (dir.wd < 0 && errno == ENOSPC && !watch_limit_warned_.exchange(true)) {
+            std::cerr << "Warning: inotify watch limit reached (fs.inotify.max_user_watches); "
+                         "changes below " << path << " and later directories will be missed" << std::endl;
+        }
+    }
+
+    std::lock_guard lock(index_mutex_);
+    if (dir.wd >= 0) watch_paths_[dir.wd] = path.string();
+    directories_[path.string()] = dir;
+}
+
+void DirectoryWatcher::read_events() {
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        ssize_t n = ::read(inotify_fd_, buffer, sizeof(buffer));
+        if (n <= 0) return; // EAGAIN: drained
+
+        for (ssize_t offset = 0; offset < n;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed_ = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watch_paths_.erase(event->wd);
+                continue;
+            }
+            if (event->len == 0) continue; // self events are reported by the parent as well
+            auto it = watch_paths_.find(event->wd);
+            if (it == watch_paths_.end()) continue;
+            dirty_.insert(it->second + "/" + event->name);
+        }
+    }
+}
+
+void DirectoryWatcher::apply_changes() {
+    if (overflowed_) {
+        // Events were lost; nothing short of a rescan is exact.
+        std::cerr << "Warning: inotify queue overflowed, rescanning " << options_.target_path << std::endl;
+        full_scan();
+        return;
+    }
+
+    if (options_.use_ignore_files) {
+        // A changed ignore file can flip anything below it; rescan rather
+        // than work out which paths it affects.
+        for (const auto& path : dirty_) {
+            if (!is_ignore_file(fs::path(path).filename().string())) continue;
+            full_scan();
+            return;
+        }
+    }
+
+    for (const auto& path : dirty_) refresh_path(path);
+    dirty_.clear();
+
+    if (top_lists_stale_) {
+        refill_top_lists();
+        top_lists_stale_ = false;
+    }
+}
+
+void DirectoryWatcher::refill_top_lists() {
+    // Files outside the reserve rank below everything it held when it was
+    // last full, and replacements only raise that, so while no more than
+    // capacity - top_count of those have been removed its best top_count
+    // are the true ones. Past that, one pass over the index rebuilds it.
+    if (reserve_removals_ > reserve_.capacity() - options_.top_count) {
+        reserve_.clear();
+        for (const auto& [path, entry] : files_) reserve_.offer(path, ranked(entry));
+        reserve_removals_ = 0;
+    }
+    stats_.top_files.clear();
+    reserve_.for_each_file([&](std::string_view path, const RankedAttributes& attributes) {
+        stats_.top_files.offer(path, attributes);
+    });
+}
+
+void DirectoryWatcher::refresh_path(const std::string& path) {
+    fs::path fs_path(path);
+    if (options_.skip_hidden && fs_path.filename().string().front() == '.') return;
+
+    // Only paths inside directories we actually read can be part of the stats.
+    auto parent = directories_.find(fs_path.parent_path().string());
+    if (parent == directories_.end()) return;
+    if (options_.max_depth != -1 && parent->second.depth > options_.max_depth) return;
+
+    FileMetadata metadata;
+    std::error_code ec;
+    bool exists = read_metadata(kCurrentDirFd, path.c_str(), analyzer_.metadata_fields() | kFieldInode, metadata, ec);
+    // An excluded path is handled like a deleted one: whatever was there goes.
+    if (exists && !analyzer_.selects(fs_path, metadata.type, parent->second.ignore.get())) exists = false;
+
+    if (auto file = files_.find(path); file != files_.end()) {
+        untrack_age(file->second);
+        if (reserve_.remove(path)) reserve_removals_++;
+        if (analyzer_.remove_file(file->second, stats_)) top_lists_stale_ = true;
+        files_.erase(file);
+    }
+    if (auto dir = directories_.find(path); dir != directories_.end()) {
+        bool same_directory = exists && metadata.type == fs::file_type::directory && metadata.inode == dir->second.inode;
+        if (same_directory) return;
+        remove_subtree(path);
+    }
+    if (!exists) return;
+
+    if (metadata.type == fs::file_type::regular) {
+        // add_file reports back through on_file, which indexes the entry.
+        analyzer_.add_file(fs_path, metadata, stats_);
+        if (auto file = files_.find(path); file != files_.end()) track_age(file->second);
+    } else if (metadata.type == fs::file_type::directory) {
+        stats_.total_directories++;
+        int depth = parent->second.depth + 1;
+        if (options_.max_depth != -1 && depth > options_.max_depth) {
+            on_directory(fs_path, depth); // counted, never read
+            return;
+        }
+        // New or moved-in subtree: scan just that part and fold it in. Its
+        // ages are taken against the watcher's clock, like every other file's.
+        FileSystemAnalyzer scanner(scan_options(fs_path, depth, parent->second.ignore));
+        DirectoryStats subtree = scanner.analyze();
+        for (auto& range : subtree.age_distribution) range.count = 0;
+        const auto [first_file, last_file] = subtree_range(files_, path);
+        for (auto it = first_file; it != last_file; ++it) {
+            subtree.age_distribution[analyzer_.age_bucket(it->second.last_modified)].count++;
+            track_age(it->second);
+        }
+        stats_.merge(subtree);
+    }
+}
+
+void DirectoryWatcher::remove_subtree(const std::string& path) {
+    // Only the subtree's own entries are visited, not the whole index.
+    const auto [first_file, last_file] = subtree_range(files_, path);
+    for (auto it = first_file; it != last_file; ++it) {
+        untrack_age(it->second);
+        if (reserve_.remove(it->first)) reserve_removals_++;
+        if (analyzer_.remove_file(it->second, stats_)) top_lists_stale_ = true;
+    }
+    files_.erase(first_file, last_file);
+
+    auto forget = [&](const WatchedDirectory& dir) {
+        if (dir.wd >= 0) {
+            ::inotify_rm_watch(inotify_fd_, dir.wd);
+            watch_paths_.erase(dir.wd);
+        }
+        stats_.total_directories--;
+    };
+    const auto [first_dir, last_dir] = subtree_range(directories_, path);
+    for (auto it = first_dir; it != last_dir; ++it) forget(it->second);
+    directories_.erase(first_dir, last_dir);
+    if (auto dir = directories_.find(path); dir != directories_.end()) {
+        forget(dir->second);
+        directories_.erase(dir);
+    }
+}
+
+#else
+
+bool DirectoryWatcher::run(std::chrono::milliseconds, const ReportCallback&) {
+    std::cerr << "Error: watch mode requires Linux inotify" << std::endl;
+    return false;
+}
+
+void DirectoryWatcher::full_scan() {}
+void DirectoryWatcher::on_directory(const fs::path&, int, std::shared_ptr<const IgnoreFrame>) {}
+void DirectoryWatcher::read_events() {}
+void DirectoryWatcher::apply_changes() {}
+void DirectoryWatcher::refresh_path(const std::string&) {}
+void DirectoryWatcher::remove_subtree(const std::string&) {}
+
+#endif
+
+void DirectoryWatcher::refresh_ages() {
+    // Ages move with the wall clock even when nothing changes on disk. A
+    // file passes limit i, from bucket i to i + 1, when its mtime lies in
+    // (before - limit, now - limit]; one passing several limits at once
+    // moves once per limit.
+    const auto before = analyzer_.clock();
+    analyzer_.reset_clock();
+    const auto now = analyzer_.clock();
+    auto& ages = stats_.age_distribution;
+    for (size_t i = 0; i < FileSystemAnalyzer::kAgeLimits.size(); ++i) {
+        const auto limit = FileSystemAnalyzer::kAgeLimits[i];
+        uint64_t passed = 0;
+        for (auto it = recent_mtimes_.upper_bound(before - limit); it != recent_mtimes_.upper_bound(now - limit); ++it) {
+            passed += it->second;
+        }
+        ages[i].count -= passed;
+        ages[i + 1].count += passed;
+    }
+    // The oldest bucket is final.
+    recent_mtimes_.erase(recent_mtimes_.begin(), recent_mtimes_.upper_bound(now - FileSystemAnalyzer::kAgeLimits.back()));
+}
+
+void DirectoryWatcher::recount_ages() {
+    recent_mtimes_.clear();
+    for (auto& range : stats_.age_distribution) range.count = 0;
+    for (const auto& [path, entry] : files_) {
+        stats_.age_distribution[analyzer_.age_bucket(entry.last_modified)].count++;
+        track_age(entry);
+    }
+}
+
+void DirectoryWatcher::track_age(const FileEntry& entry) {
+    if (analyzer_.age_bucket(entry.last_modified) < FileSystemAnalyzer::kAgeLimits.size()) {
+        recent_mtimes_[entry.last_modified]++;
+    }
+}
+
+void DirectoryWatcher::untrack_age(const FileEntry& entry) {
+    // Files already in the oldest bucket were never tracked or have been dropped.
+    auto it = recent_mtimes_.find(entry.last_modified);
+    if (it != recent_mtimes_.end() && --it->second == 0) recent_mtimes_.erase(it);
+}
+
+} // namespace analyzer
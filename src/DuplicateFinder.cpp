@@ -0,0 +1,335 @@
+#include "DuplicateFinder.hpp"
+#include "IoThrottle.hpp"
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <tuple>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define ANALYZER_HAVE_PREAD 1
+#else
+#include <fstream>
+#endif
+
+namespace analyzer {
+
+namespace {
+
+constexpr size_t kReadChunk = 1 << 20;
+
+// Streaming XXH64. Two instances with different seeds give the 128-bit
+// digest used for grouping, so accidental collisions are not a concern even
+// across hundreds of millions of files.
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed)
+        : lanes_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1}, seed_(seed) {}
+
+    void update(const unsigned char* data, size_t length) {
+        total_length_ += length;
+        while (length > 0) {
+            if (buffered_ == 0) {
+                for (; length >= kStripe; data += kStripe, length -= kStripe) consume(data);
+                if (length == 0) break;
+            }
+            size_t take = std::min(length, kStripe - buffered_);
+            std::memcpy(buffer_ + buffered_, data, take);
+            buffered_ += take;
+            data += take;
+            length -= take;
+            if (buffered_ == kStripe) {
+                consume(buffer_);
+                buffered_ = 0;
+            }
+        }
+    }
+
+    uint64_t digest() const {
+        uint64_t h;
+        if (total_length_ >= kStripe) {
+            h = rotl(lanes_[0], 1) + rotl(lanes_[1], 7) + rotl(lanes_[2], 12) + rotl(lanes_[3], 18);
+            for (uint64_t lane : lanes_) h = (h ^ round(0, lane)) * kPrime1 + kPrime4;
+        } else {
+            h = seed_ + kPrime5;
+        }
+        h += total_length_;
+
+        const unsigned char* p = buffer_;
+        size_t remaining = buffered_;
+        for (; remaining >= 8; p += 8, remaining -= 8) h = rotl(h ^ round(0, load<uint64_t>(p)), 27) * kPrime1 + kPrime4;
+        if (remaining >= 4) {
+            h = rotl(h ^ (load<uint32_t>(p) * kPrime1), 23) * kPrime2 + kPrime3;
+            p += 4;
+            remaining -= 4;
+        }
+        for (; remaining > 0; ++p, --remaining) h = rotl(h ^ (*p * kPrime5), 11) * kPrime1;
+
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        return h ^ (h >> 32);
+    }
+
+private:
+    static constexpr size_t kStripe = 32;
+    static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+    static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+    static constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+    static constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+    static constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * kPrime2, 31) * kPrime1; }
+
+    template <typename T>
+    static T load(const unsigned char* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    void consume(const unsigned char* stripe) {
+        for (size_t i = 0; i < 4; ++i) lanes_[i] = round(lanes_[i], load<uint64_t>(stripe + i * 8));
+    }
+
+    uint64_t lanes_[4];
+    uint64_t seed_;
+    uint64_t total_length_ = 0;
+    unsigned char buffer_[kStripe];
+    size_t buffered_ = 0;
+};
+
+class ContentHasher {
+public:
+    void update(const char* data, size_t length) {
+        low_.update(reinterpret_cast<const unsigned char*>(data), length);
+        high_.update(reinterpret_cast<const unsigned char*>(data), length);
+    }
+    std::array<uint64_t, 2> digest() const { return {low_.digest(), high_.digest()}; }
+
+private:
+    Xxh64 low_{0};
+    Xxh64 high_{0x9E3779B97F4A7C15ull};
+};
+
+// Plain positional reads rather than mmap: a file truncated while it is
+// being hashed then shows up as a short read instead of SIGBUS. Symlinks
+// are only opened when the scan followed them to reach the file.
+class InputFile {
+public:
+    InputFile(const fs::path& path, bool follow_symlinks) {
+#ifdef ANALYZER_HAVE_PREAD
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | (follow_symlinks ? 0 : O_NOFOLLOW));
+#ifdef POSIX_FADV_SEQUENTIAL
+        if (fd_ >= 0) ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#else
+        (void)follow_symlinks;
+        in_.open(path, std::ios::binary);
+#endif
+    }
+
+    ~InputFile() {
+#ifdef ANALYZER_HAVE_PREAD
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+#ifdef ANALYZER_HAVE_PREAD
+    bool is_open() const { return fd_ >= 0; }
+#else
+    bool is_open() const { return in_.is_open(); }
+#endif
+
+    // Reads exactly `length` bytes at `offset`; false on error or a file that got shorter.
+    bool read_at(uint64_t offset, char* buffer, size_t length) {
+#ifdef ANALYZER_HAVE_PREAD
+        while (length > 0) {
+            ssize_t n = ::pread(fd_, buffer, length, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer += n;
+            offset += static_cast<uint64_t>(n);
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+#else
+        in_.seekg(static_cast<std::streamoff>(offset));
+        in_.read(buffer, static_cast<std::streamsize>(length));
+        return static_cast<size_t>(in_.gcount()) == length;
+#endif
+    }
+
+private:
+#ifdef ANALYZER_HAVE_PREAD
+    int fd_ = -1;
+#else
+    std::ifstream in_;
+#endif
+};
+
+// Sorts by `less` and drops every element that is not part of a run of at
+// least two `equal` elements.
+template <typename T, typename Less, typename Equal>
+void keep_groups(std::vector<T>& items, Less less, Equal equal) {
+    std::sort(items.begin(), items.end(), less);
+    std::vector<T> kept;
+    for (size_t begin = 0, end; begin < items.size(); begin = end) {
+        for (end = begin + 1; end < items.size() && equal(items[begin], items[end]); ++end) {}
+        if (end - begin < 2) continue;
+        std::move(items.begin() + static_cast<std::ptrdiff_t>(begin), items.begin() + static_cast<std::ptrdiff_t>(end),
+                  std::back_inserter(kept));
+    }
+    items.swap(kept);
+}
+
+} // namespace
+
+DuplicateFinder::DuplicateFinder(AnalysisOptions options) : options_(std::move(options)) {
+    // Replayed directories do not report their files.
+    options_.cache_path.clear();
+    // Links to one inode are the same bytes on disk, not reclaimable copies.
+    options_.count_hard_links = false;
+    if (options_.max_read_bytes_per_second > 0) {
+        throttle_ = std::make_unique<IoThrottle>(
+            IoThrottle::Limits{0, options_.max_read_bytes_per_second, options_.latency_target});
+    }
+}
+
+DuplicateFinder::~DuplicateFinder() = default;
+
+std::vector<DuplicateFinder::Candidate> DuplicateFinder::collect(DuplicateReport& report) {
+    std::vector<Candidate> candidates;
+    std::mutex mutex;
+
+    AnalysisOptions options = options_;
+    options.on_file = [&](const FileEntry& entry, const FileMetadata&) {
+        if (entry.size == 0) return; // all empty files are "equal" but reclaim nothing
+        std::lock_guard lock(mutex);
+        candidates.push_back({entry.path, entry.size});
+    };
+    FileSystemAnalyzer scanner(options);
+    const DirectoryStats stats = scanner.analyze();
+    report.files_scanned = stats.total_files;
+    report.scan_errors = stats.errors.total;
+    return candidates;
+}
+
+bool DuplicateFinder::hash_file(Candidate& candidate, bool full_content, uint64_t& bytes_read) const {
+    thread_local std::vector<char> buffer(kReadChunk);
+
+    InputFile file(candidate.path, options_.follow_symlinks);
+    if (!file.is_open()) return false;
+    auto read_at = [&](uint64_t offset, char* into, size_t length) {
+        if (!throttle_) return file.read_at(offset, into, length);
+        throttle_->pace_bytes(length);
+        const auto start = IoThrottle::Clock::now();
+        const bool ok = file.read_at(offset, into, length);
+        // Per 4 KiB, so one large read does not look like a slow small one.
+        throttle_->observe(IoThrottle::Clock::now() - start, std::max<size_t>(1, length / 4096));
+        return ok;
+    };
+
+    ContentHasher hasher;
+    if (!full_content && candidate.size > 2 * kEdgeBytes) {
+        uint64_t tail = candidate.size - kEdgeBytes;
+        if (!read_at(0, buffer.data(), kEdgeBytes) || !read_at(tail, buffer.data() + kEdgeBytes, kEdgeBytes)) {
+            return false;
+        }
+        hasher.update(buffer.data(), 2 * kEdgeBytes);
+        bytes_read += 2 * kEdgeBytes;
+    } else {
+        for (uint64_t offset = 0; offset < candidate.size;) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(kReadChunk, candidate.size - offset));
+            if (!read_at(offset, buffer.data(), length)) return false;
+            hasher.update(buffer.data(), length);
+            offset += length;
+        }
+        bytes_read += candidate.size;
+        candidate.fully_hashed = true;
+    }
+    candidate.digest = hasher.digest();
+    return true;
+}
+
+void DuplicateFinder::hash_all(std::vector<Candidate>& candidates, bool full_content, DuplicateReport& report) const {
+    std::atomic<uint64_t> bytes_read{0};
+    auto hash_one = [&](Candidate& candidate) {
+        uint64_t read = 0;
+        candidate.readable = hash_file(candidate, full_content, read);
+        bytes_read.fetch_add(read, std::memory_order_relaxed);
+    };
+
+    if (options_.thread_count > 1) {
+        WorkStealingPool<size_t> pool(options_.thread_count);
+        for (size_t i = 0; i < candidates.size(); ++i) pool.submit(static_cast<unsigned>(i), i);
+        pool.run([&](unsigned, size_t& index) { hash_one(candidates[index]); });
+    } else {
+        for (auto& candidate : candidates) hash_one(candidate);
+    }
+    report.bytes_read += bytes_read.load();
+
+    auto unreadable = std::remove_if(candidates.begin(), candidates.end(), [&](const Candidate& candidate) {
+        if (candidate.readable) return false;
+        // Counted, not printed: a tree of unreadable files would spend its
+        // time in flushed stderr writes.
+        report.unreadable_files++;
+        if (report.unreadable_samples.size() < ErrorSummary::kMaxSamples) report.unreadable_samples.push_back(candidate.path);
+        return true;
+    });
+    candidates.erase(unreadable, candidates.end());
+}
+
+DuplicateReport DuplicateFinder::find() {
+    DuplicateReport report;
+    auto by_size = [](const Candidate& a, const Candidate& b) { return a.size < b.size; };
+    auto same_size = [](const Candidate& a, const Candidate& b) { return a.size == b.size; };
+    auto by_digest = [](const Candidate& a, const Candidate& b) {
+        return std::tie(a.size, a.digest, a.path) < std::tie(b.size, b.digest, b.path);
+    };
+    auto same_digest = [](const Candidate& a, const Candidate& b) { return a.size == b.size && a.digest == b.digest; };
+
+    // Stage 1: a file with a unique size has no duplicate.
+    std::vector<Candidate> candidates = collect(report);
+    keep_groups(candidates, by_size, same_size);
+    report.size_candidates = candidates.size();
+
+    // Stage 2: head and tail. Small files are read whole here and are final.
+    hash_all(candidates, false, report);
+    keep_groups(candidates, by_digest, same_digest);
+    report.partial_candidates = candidates.size();
+
+    // Stage 3: full content for whatever stage 2 could not settle.
+    std::vector<Candidate> confirmed;
+    std::vector<Candidate> pending;
+    for (auto& candidate : candidates) (candidate.fully_hashed ? confirmed : pending).push_back(std::move(candidate));
+    hash_all(pending, true, report);
+    std::move(pending.begin(), pending.end(), std::back_inserter(confirmed));
+    keep_groups(confirmed, by_digest, same_digest);
+
+    for (size_t begin = 0, end; begin < confirmed.size(); begin = end) {
+        DuplicateSet set;
+        set.size = confirmed[begin].size;
+        for (end = begin; end < confirmed.size() && same_digest(confirmed[begin], confirmed[end]); ++end) {
+            set.paths.push_back(std::move(confirmed[end].path));
+        }
+        report.reclaimable_bytes += set.reclaimable_bytes();
+        report.sets.push_back(std::move(set));
+    }
+    std::sort(report.sets.begin(), report.sets.end(), [](const DuplicateSet& a, const DuplicateSet& b) {
+        if (a.reclaimable_bytes() != b.reclaimable_bytes()) return a.reclaimable_bytes() > b.reclaimable_bytes();
+        return a.paths.front() < b.paths.front();
+    });
+    return report;
+}
+
+} // namespace analyzer
@@ -0,0 +1,49 @@
+#include "ErrorSummary.hpp"
+#include <algorithm>
+
+namespace analyzer {
+
+const char* operation_name(ErrorOperation operation) {
+    switch (operation) {
+        case ErrorOperation::Stat: return "stat";
+        case ErrorOperation::Open: return "open";
+        case ErrorOperation::Read: return "read";
+    }
+    return "?";
+}
+
+void ErrorSummary::add_directory(const std::string& path, uint64_t errors) {
+    if (errors == 0) return;
+    directories++;
+    if (worst_directories.size() < kMaxDirectories) {
+        worst_directories.push_back({path, errors});
+        return;
+    }
+    // Ten entries: a scan for the smallest beats keeping a heap.
+    auto least = std::min_element(worst_directories.begin(), worst_directories.end(),
+                                  [](const Directory& a, const Directory& b) { return a.errors < b.errors; });
+    if (errors > least->errors) *least = {path, errors};
+}
+
+void ErrorSummary::merge(const ErrorSummary& other) {
+    total += other.total;
+    // Each directory is read by one worker only, so none is offered twice.
+    const uint64_t own_directories = directories;
+    for (const auto& dir : other.worst_directories) add_directory(dir.path, dir.errors);
+    directories = own_directories + other.directories;
+    for (const auto& [code, count] : other.by_code) by_code[code] += count;
+    for (const auto& sample : other.samples) {
+        if (samples.size() >= kMaxSamples) break;
+        samples.push_back(sample);
+    }
+}
+
+void ErrorSummary::finalize() {
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.path < b.path; });
+    std::sort(worst_directories.begin(), worst_directories.end(), [](const Directory& a, const Directory& b) {
+        if (a.errors != b.errors) return a.errors > b.errors;
+        return a.path < b.path;
+    });
+}
+
+} // namespace analyzer
@@ -0,0 +1,108 @@
+#include "ExtensionTable.hpp"
+#include <cmath>
+#include <functional>
+
+namespace analyzer {
+
+namespace {
+
+constexpr size_t kInitialSlots = 64; // power of two
+
+} // namespace
+
+std::string_view extension_of(const fs::path& path) {
+    return extension_of(std::string_view(path.native()));
+}
+
+std::string_view extension_of(std::string_view path) {
+    std::string_view name = path;
+    if (auto slash = name.rfind('/'); slash != std::string_view::npos) name.remove_prefix(slash + 1);
+    if (name == "." || name == "..") return kNoExtension;
+
+    auto dot = name.rfind('.');
+    if (dot == std::string_view::npos || dot == 0) return kNoExtension;
+    return name.substr(dot);
+}
+
+uint32_t ExtensionTable::intern(std::string_view extension) {
+    // Keep the load factor at or below one half.
+    if ((names_.size() + 1) * 2 > slots_.size()) grow();
+
+    const uint64_t hash = std::hash<std::string_view>{}(extension);
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint32_t slot = slots_[i];
+        if (slot == 0) {
+            if (max_extensions_ != 0 && names_.size() + 1 >= max_extensions_ && extension != kOtherExtensions) {
+                return intern(kOtherExtensions);
+            }
+            auto id = static_cast<uint32_t>(names_.size());
+            names_.emplace_back(extension);
+            hashes_.push_back(hash);
+            totals_.emplace_back();
+            histograms_.emplace_back(histogram_precision_);
+            slots_[i] = id + 1;
+            return id;
+        }
+        if (hashes_[slot - 1] == hash && names_[slot - 1] == extension) return slot - 1;
+    }
+}
+
+size_t ExtensionTable::entry_bytes(unsigned histogram_precision) {
+    // A full histogram (whose vector may hold up to twice its buckets after
+    // growing), a short name and the per-id bookkeeping; slots_ adds two
+    // more ids per entry at half load.
+    const size_t buckets = size_t{65 - histogram_precision} << histogram_precision;
+    return 2 * buckets * sizeof(uint64_t) + sizeof(SizeHistogram) + sizeof(std::string) + 16 + sizeof(uint64_t) +
+           sizeof(Totals) + 2 * sizeof(uint32_t);
+}
+
+void ExtensionTable::grow() {
+    std::vector<uint32_t> bigger(slots_.empty() ? kInitialSlots : slots_.size() * 2, 0);
+    const size_t mask = bigger.size() - 1;
+    for (uint32_t id = 0; id < names_.size(); ++id) {
+        size_t i = hashes_[id] & mask;
+        while (bigger[i] != 0) i = (i + 1) & mask;
+        bigger[i] = id + 1;
+    }
+    slots_.swap(bigger);
+}
+
+void ExtensionTable::remove(std::string_view extension, uint64_t size) {
+    const uint32_t id = intern(extension);
+    totals_[id].count--;
+    totals_[id].size -= size;
+    histograms_[id].remove(size);
+}
+
+void ExtensionTable::merge(const ExtensionTable& other) {
+    for (uint32_t id = 0; id < other.size(); ++id) {
+        const uint32_t own = intern(other.names_[id]);
+        add_totals(own, other.totals_[id].count, other.totals_[id].size);
+        histograms_[own].merge(other.histograms_[id]);
+    }
+}
+
+void ExtensionTable::scale(double weight) {
+    auto scaled = [weight](uint64_t value) { return static_cast<uint64_t>(std::llround(static_cast<double>(value) * weight)); };
+    for (uint32_t id = 0; id < names_.size(); ++id) {
+        totals_[id].count = scaled(totals_[id].count);
+        totals_[id].size = scaled(totals_[id].size);
+        histograms_[id].scale(weight);
+    }
+}
+
+void ExtensionTable::export_to(std::map<std::string, uint64_t>& counts, std::map<std::string, uint64_t>& sizes,
+                               std::map<std::string, SizePercentiles>& percentiles) const {
+    counts.clear();
+    sizes.clear();
+    percentiles.clear();
+    for (uint32_t id = 0; id < names_.size(); ++id) {
+        if (totals_[id].count == 0) continue;
+        counts.emplace(names_[id], totals_[id].count);
+        sizes.emplace(names_[id], totals_[id].size);
+        percentiles.emplace(names_[id], histograms_[id].percentiles());
+    }
+}
+
+} // namespace analyzer
@@ -0,0 +1,134 @@
+#include "FileMetadata.hpp"
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#define ANALYZER_HAVE_FSTATAT 1
+#endif
+
+namespace analyzer {
+
+#ifdef ANALYZER_HAVE_FSTATAT
+const int kCurrentDirFd = AT_FDCWD;
+#else
+const int kCurrentDirFd = -100;
+#endif
+
+namespace {
+
+[[maybe_unused]] fs::file_time_type to_file_time(int64_t seconds, int64_t nanoseconds) {
+    auto sys = std::chrono::sys_seconds(std::chrono::seconds(seconds)) + std::chrono::nanoseconds(nanoseconds);
+#ifdef __GLIBCXX__
+    return fs::file_time_type::clock::from_sys(std::chrono::time_point_cast<fs::file_time_type::duration>(sys));
+#else
+    auto delta = std::chrono::duration_cast<fs::file_time_type::duration>(sys - std::chrono::system_clock::now());
+    return fs::file_time_type::clock::now() + delta;
+#endif
+}
+
+[[maybe_unused]] fs::file_type type_from_mode(unsigned mode) {
+#ifdef ANALYZER_HAVE_FSTATAT
+    if (S_ISREG(mode)) return fs::file_type::regular;
+    if (S_ISDIR(mode)) return fs::file_type::directory;
+    if (S_ISLNK(mode)) return fs::file_type::symlink;
+    return fs::file_type::unknown;
+#else
+    (void)mode;
+    return fs::file_type::unknown;
+#endif
+}
+
+} // namespace
+
+#if defined(__linux__) && defined(STATX_TYPE)
+
+unsigned statx_mask(unsigned fields) {
+    unsigned mask = 0;
+    if (fields & kFieldType) mask |= STATX_TYPE;
+    if (fields & kFieldSize) mask |= STATX_SIZE;
+    if (fields & kFieldModTime) mask |= STATX_MTIME;
+    if (fields & kFieldBlocks) mask |= STATX_BLOCKS;
+    if (fields & kFieldInode) mask |= STATX_INO | STATX_NLINK;
+    if (fields & kFieldOwner) mask |= STATX_UID | STATX_GID;
+    if (fields & kFieldAccessTime) mask |= STATX_ATIME;
+    if (fields & kFieldChangeTime) mask |= STATX_CTIME;
+    return mask;
+}
+
+void fill_metadata(const struct ::statx& stx, FileMetadata& out) {
+    out.type = type_from_mode(stx.stx_mode);
+    out.size = stx.stx_size;
+    out.blocks = stx.stx_blocks;
+    out.device = (static_cast<uint64_t>(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+    out.inode = stx.stx_ino;
+    out.nlink = stx.stx_nlink;
+    out.uid = stx.stx_uid;
+    out.gid = stx.stx_gid;
+    out.last_modified = to_file_time(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec);
+    if (stx.stx_mask & STATX_ATIME) out.last_accessed = to_file_time(stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec);
+    if (stx.stx_mask & STATX_CTIME) out.last_changed = to_file_time(stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec);
+}
+
+bool read_metadata(int dir_fd, const char* name, unsigned fields, FileMetadata& out, std::error_code& ec,
+                   bool follow_symlinks) {
+    struct statx stx;
+    const int flags = (follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW) | AT_NO_AUTOMOUNT;
+    if (::statx(dir_fd, name, flags, statx_mask(fields), &stx) != 0) {
+        ec.assign(errno, std::generic_category());
+        return false;
+    }
+    fill_metadata(stx, out);
+    return true;
+}
+
+#elif defined(ANALYZER_HAVE_FSTATAT)
+
+bool read_metadata(int dir_fd, const char* name, unsigned, FileMetadata& out, std::error_code& ec,
+                   bool follow_symlinks) {
+    struct stat st;
+    if (::fstatat(dir_fd, name, &st, follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW) != 0) {
+        ec.assign(errno, std::generic_category());
+        return false;
+    }
+
+    out.type = type_from_mode(st.st_mode);
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.blocks = static_cast<uint64_t>(st.st_blocks);
+    out.device = static_cast<uint64_t>(st.st_dev);
+    out.inode = static_cast<uint64_t>(st.st_ino);
+    out.nlink = static_cast<uint32_t>(st.st_nlink);
+    out.uid = st.st_uid;
+    out.gid = st.st_gid;
+#ifdef __APPLE__
+    out.last_modified = to_file_time(st.st_mtimespec.tv_sec, st.st_mtimespec.tv_nsec);
+    out.last_accessed = to_file_time(st.st_atimespec.tv_sec, st.st_atimespec.tv_nsec);
+    out.last_changed = to_file_time(st.st_ctimespec.tv_sec, st.st_ctimespec.tv_nsec);
+#else
+    out.last_modified = to_file_time(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    out.last_accessed = to_file_time(st.st_atim.tv_sec, st.st_atim.tv_nsec);
+    out.last_changed = to_file_time(st.st_ctim.tv_sec, st.st_ctim.tv_nsec);
+#endif
+    return true;
+}
+
+#else
+
+bool read_metadata(int, const char* name, unsigned fields, FileMetadata& out, std::error_code& ec,
+                   bool follow_symlinks) {
+    fs::path path(name);
+    auto status = follow_symlinks ? fs::status(path, ec) : fs::symlink_status(path, ec);
+    if (ec) return false;
+    out.type = status.type();
+    if (out.type == fs::file_type::regular) {
+        if (fields & kFieldSize) out.size = fs::file_size(path, ec);
+        if (!ec && (fields & kFieldModTime)) out.last_modified = fs::last_write_time(path, ec);
+        out.blocks = (out.size + 511) / 512;
+    }
+    return !ec;
+}
+
+#endif
+
+} // namespace analyzer
@@ -1,124 +1,1223 @@
 #include "FileSystemAnalyzer.hpp"
+#include "DirectoryTree.hpp"
+#include "IgnoreRules.hpp"
+#include "InodeSet.hpp"
+#include "IoThrottle.hpp"
+#include "NativeDirectoryReader.hpp"
+#include "ScanCache.hpp"
+#include "ScanProgress.hpp"
+#include "UringStatEngine.hpp"
+#include "WorkStealingPool.hpp"
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
 #include <iostream>
+#include <iterator>
+#include <random>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace analyzer {
 
+namespace {
+
+// FNV-1a: stable across runs, builds and hosts, which std::hash is not.
+uint64_t stable_hash(std::string_view text) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (unsigned char c : text) hash = (hash ^ c) * 0x100000001b3;
+    return hash;
+}
+
+uint64_t mix(uint64_t x) {
+    // splitmix64 finalizer
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+std::atomic<uint64_t> next_analyzer_id{1};
+
+} // namespace
+
 FileSystemAnalyzer::FileSystemAnalyzer(AnalysisOptions options) 
-    : options_(std::move(options)) {}
+    : options_(std::move(options)), id_(next_analyzer_id.fetch_add(1, std::memory_order_relaxed)),
+      metadata_fields_(required_metadata_fields()),
+      matcher_(options_.include_patterns, options_.exclude_patterns),
+      pattern_root_((options_.pattern_root.empty() ? options_.target_path : options_.pattern_root).native()),
+      linked_inodes_(std::make_unique<InodeSet>()), visited_directories_(std::make_unique<InodeSet>()),
+      tree_(std::make_unique<DirectoryTree>()) {}
+
+FileSystemAnalyzer::~FileSystemAnalyzer() = default;
+
+unsigned FileSystemAnalyzer::required_metadata_fields() const {
+    // Size feeds totals and the size histogram, mtime the age buckets and the
+    // oldest/newest lists. Type is needed to classify DT_UNKNOWN entries,
+    // blocks the allocated size, inode/nlink the hard-link dedup.
+    unsigned fields = kFieldType | kFieldSize | kFieldModTime | kFieldBlocks;
+    if (!options_.count_hard_links || options_.follow_symlinks) fields |= kFieldInode;
+    if (options_.owner_usage) fields |= kFieldOwner;
+    if (options_.rankings & ranking_bit(Ranking::LeastAccessed)) fields |= kFieldAccessTime;
+    if (options_.rankings & ranking_bit(Ranking::RecentlyChanged)) fields |= kFieldChangeTime;
+    // The cache checks files by inode and ctime before replaying them.
+    if (!options_.cache_path.empty()) fields |= kFieldInode | kFieldChangeTime;
+    return fields;
+}
+
+std::string_view FileSystemAnalyzer::relative_dir(const fs::path& dir) const {
+    // Every scanned path is the root with names appended, so this is a prefix strip.
+    std::string_view path = dir.native();
+    if (path.starts_with(pattern_root_)) path.remove_prefix(pattern_root_.size());
+    while (path.starts_with('/')) path.remove_prefix(1);
+    return path;
+}
+
+bool FileSystemAnalyzer::selects(const fs::path& path, fs::file_type type, const IgnoreFrame* ignore) const {
+    if (matcher_.empty() && !options_.use_ignore_files) return true;
+    const fs::path parent = path.parent_path();
+    const std::string name = path.filename().string();
+    const std::string_view dir = relative_dir(parent);
+    const bool is_directory = type == fs::file_type::directory;
+    if (options_.use_ignore_files && is_directory && name == ".git") return false;
+    if (ignore != nullptr && is_ignored(ignore, dir, name, is_directory)) return false;
+    return is_directory ? !matcher_.excludes_directory(dir, name) : matcher_.accepts_file(dir, name);
+}
+
+bool FileSystemAnalyzer::in_other_shard(const DirectoryTask& task, std::string_view name) const {
+    if (options_.shard_count <= 1 || task.depth != 0) return false;
+    return stable_hash(name) % options_.shard_count != options_.shard_index;
+}
+
+bool FileSystemAnalyzer::skips_directory(const DirectoryTask& task, std::string_view dir, std::string_view name) const {
+    if (in_other_shard(task, name)) return true;
+    if (matcher_.excludes_directory(dir, name)) return true;
+    if (!options_.use_ignore_files) return false;
+    return name == ".git" || (task.ignore && is_ignored(task.ignore.get(), dir, name, true));
+}
+
+bool FileSystemAnalyzer::skips_file(const DirectoryTask& task, std::string_view dir, std::string_view name) const {
+    if (in_other_shard(task, name)) return true;
+    if (!matcher_.accepts_file(dir, name)) return true;
+    return task.ignore && is_ignored(task.ignore.get(), dir, name, false);
+}
+
+namespace {
+
+// Devices beyond this many share the last worker group.
+constexpr unsigned kMaxDeviceGroups = 16;
+
+// Extension tables keep at least this many entries, however small the
+// memory budget.
+constexpr size_t kMinExtensions = 64;
+
+// Size of a getdents64 record besides its name: inode, offset, length,
+// type and padding.
+constexpr size_t kDirentOverhead = 24;
+
+// A sampled scan starts sampling at the first level where it can expect to
+// keep this many subtrees; fewer make the margins themselves unreliable.
+constexpr double kMinSampledSubtrees = 30;
+
+// Names waiting for a batched statx. The reader's buffer is recycled on every
+// getdents refill, so names are copied into one flat NUL-separated arena.
+struct PendingStats {
+    static constexpr size_t kMaxBatch = 4096;
+
+    std::string arena;
+    std::vector<size_t> offsets;
+    std::vector<unsigned char> types; // d_type of each name
+    std::vector<const char*> names;
+
+    void add(std::string_view name, unsigned char type) {
+        offsets.push_back(arena.size());
+        types.push_back(type);
+        arena.append(name);
+        arena.push_back('\0');
+    }
+    const std::vector<const char*>& finalize() {
+        names.clear();
+        for (size_t offset : offsets) names.push_back(arena.data() + offset);
+        return names;
+    }
+    void clear() {
+        arena.clear();
+        offsets.clear();
+        types.clear();
+        names.clear();
+    }
+};
+
+} // namespace
+
+void DirectoryStats::merge(const DirectoryStats& other) {
+    total_files += other.total_files;
+    total_directories += other.total_directories;
+    total_size += other.total_size;
+    total_allocated_size += other.total_allocated_size;
+    hard_links_skipped += other.hard_links_skipped;
+    counts_every_link = counts_every_link || other.counts_every_link;
+    directories_revisited += other.directories_revisited;
+    errors.merge(other.errors);
+    partial = partial || other.partial;
+    directories_unvisited += other.directories_unvisited;
+    for (const auto& dir : other.unvisited_directories) {
+        if (unvisited_directories.size() >= kMaxUnvisitedListed) break;
+        unvisited_directories.push_back(dir);
+    }
+
+    extensions.merge(other.extensions);
+    user_usage.merge(other.user_usage);
+    group_usage.merge(other.group_usage);
+
+    for (size_t i = 0; i < std::min(size_histogram.size(), other.size_histogram.size()); ++i) {
+        size_histogram[i].count += other.size_histogram[i].count;
+    }
+    for (size_t i = 0; i < std::min(age_distribution.size(), other.age_distribution.size()); ++i) {
+        age_distribution[i].count += other.age_distribution[i].count;
+    }
+
+    top_files.merge(other.top_files);
+
+    for (const auto& mount : other.mounts) {
+        auto own = std::find_if(mounts.begin(), mounts.end(), [&](const MountSummary& m) { return m.mount_point == mount.mount_point; });
+        if (own == mounts.end()) {
+            mounts.push_back(mount);
+            continue;
+        }
+        own->directories += mount.directories;
+        own->files += mount.files;
+        own->size += mount.size;
+        own->allocated_size += mount.allocated_size;
+    }
+}
+
+void DirectoryStats::scale(double weight) {
+    auto scaled = [weight](uint64_t& value) { value = static_cast<uint64_t>(std::llround(static_cast<double>(value) * weight)); };
+    scaled(total_files);
+    scaled(total_directories);
+    scaled(total_size);
+    scaled(total_allocated_size);
+    scaled(hard_links_skipped);
+    scaled(directories_revisited);
+    extensions.scale(weight);
+    user_usage.scale(weight);
+    group_usage.scale(weight);
+    for (auto& range : size_histogram) scaled(range.count);
+    for (auto& range : age_distribution) scaled(range.count);
+    for (auto& mount : mounts) {
+        scaled(mount.directories);
+        scaled(mount.files);
+        scaled(mount.size);
+        scaled(mount.allocated_size);
+    }
+}
+
+double SampleSummary::count_margin(uint64_t count, uint64_t total) const {
+    if (!sampled() || total == 0 || files_scanned == 0) return 0;
+    // Binomial margin of the share, widened by the design effect: files come
+    // in clusters (directories), which makes them less informative than as
+    // many files drawn one by one.
+    const double share = static_cast<double>(count) / static_cast<double>(total);
+    const double variance = design_effect * share * (1 - share) / static_cast<double>(files_scanned);
+    return 1.96 * static_cast<double>(total) * std::sqrt(variance);
+}
+
+void DirectoryStats::finalize() {
+    extensions.export_to(type_distribution_count, type_distribution_size, type_size_percentiles);
+    SizeHistogram all_files;
+    for (uint32_t id = 0; id < extensions.size(); ++id) all_files.merge(extensions.histogram(id));
+    size_percentiles = all_files.percentiles();
+    largest_files = top_files.entries(Ranking::Largest);
+    oldest_files = top_files.entries(Ranking::Oldest);
+    newest_files = top_files.entries(Ranking::Newest);
+    least_accessed_files = top_files.entries(Ranking::LeastAccessed);
+    recently_changed_files = top_files.entries(Ranking::RecentlyChanged);
+    std::erase_if(mounts, [](const MountSummary& mount) { return mount.directories == 0; });
+    std::sort(unvisited_directories.begin(), unvisited_directories.end());
+    errors.finalize();
+
+    // Names are resolved here, once per id, rather than per file.
+    auto summarize = [](const OwnerTable& table, std::string (*name)(uint32_t)) {
+        std::vector<OwnerSummary> owners;
+        table.for_each([&](uint32_t id, const OwnerTable::Usage& usage) {
+            owners.push_back({id, name(id), usage.files, usage.size, usage.allocated_size});
+        });
+        std::sort(owners.begin(), owners.end(), [](const OwnerSummary& a, const OwnerSummary& b) {
+            if (a.size != b.size) return a.size > b.size;
+            return a.id < b.id;
+        });
+        return owners;
+    };
+    users = summarize(user_usage, user_name);
+    groups = summarize(group_usage, group_name);
+}
 
 DirectoryStats FileSystemAnalyzer::analyze() {
     DirectoryStats stats;
-    initialize_histogram(stats);
+    load_mounts();
+    apply_memory_budget();
+    start_throttle();
+    initialize_stats(stats);
+    scan_time_ = fs::file_time_type::clock::now();
+    deadline_ = options_.time_limit.count() > 0 ? std::chrono::steady_clock::now() + options_.time_limit
+                                                : std::chrono::steady_clock::time_point::max();
+    stopped_.store(false, std::memory_order_relaxed);
     
     try {
-        if (!fs::exists(options_.target_path) || !fs::is_directory(options_.target_path)) {
+        std::error_code target_ec;
+        if (!fs::is_directory(options_.target_path, target_ec)) {
             std::cerr << "Error: Target path does not exist or is not a directory: " << options_.target_path << std::endl;
             return stats;
         }
-        traverse(options_.target_path, 0, stats);
+        if (options_.backend == TraversalBackend::Native && !kNativeTraversalSupported) {
+            std::cerr << "Warning: native traversal backend is not available on this platform, using portable backend" << std::endl;
+        }
+        if (options_.metadata_engine == MetadataEngine::IoUring && options_.backend != TraversalBackend::Native) {
+            std::cerr << "Warning: io_uring stat engine requires the native backend, using synchronous stats" << std::endl;
+        }
+        if (!options_.cache_path.empty() && options_.use_ignore_files) {
+            // Editing an ignore file changes what is counted below it without
+            // touching any directory mtime the cache could notice.
+            std::cerr << "Warning: scan cache is not used together with ignore files" << std::endl;
+        } else if (!options_.cache_path.empty() && options_.memory_budget != 0) {
+            std::cerr << "Warning: scan cache is not used with a memory budget" << std::endl;
+        } else if (!options_.cache_path.empty() && options_.follow_symlinks) {
+            // Which path reaches a directory or file first, and so counts it,
+            // depends on the order of the whole scan, not on one directory.
+            std::cerr << "Warning: scan cache is not used when following symlinks" << std::endl;
+        } else if (!options_.cache_path.empty()) {
+            cache_ = std::make_unique<ScanCache>(cache_fingerprint());
+            cache_->load(options_.cache_path);
+        }
+        tree_->add_root(options_.target_path);
+        if (options_.follow_symlinks) {
+            FileMetadata metadata;
+            std::error_code ec;
+            if (read_metadata(kCurrentDirFd, options_.target_path.c_str(), kFieldType | kFieldInode, metadata, ec, true)) {
+                visited_directories_->insert(metadata.device, metadata.inode);
+            }
+        }
+        DirectoryTask root{options_.target_path, 0};
+        root.ignore = options_.ignore_base;
+        if (options_.use_ignore_files) root.ignore = load_ignore_frame(root.ignore, root.path, relative_dir(root.path));
+        if (options_.sample_fraction < 1) {
+            traverse_sampled(std::move(root), stats);
+        } else if (options_.thread_count > 1) {
+            traverse_parallel(std::move(root), stats);
+        } else {
+            traverse(std::move(root), stats);
+        }
+        // After an early stop the directories not reached keep their records.
+        if (cache_ && !cache_->save(options_.cache_path, stopped_.load(std::memory_order_relaxed))) {
+            std::cerr << "Warning: Could not write scan cache " << options_.cache_path << std::endl;
+        }
+        if (linked_inodes_->sketched() > 0) {
+            std::cerr << "Warning: " << linked_inodes_->sketched() << " hard-linked inodes did not fit the memory budget;"
+                      << " a few of their first links may have been taken for repeats" << std::endl;
+        }
+        if (visited_directories_->sketched() > 0) {
+            std::cerr << "Warning: " << visited_directories_->sketched() << " directories did not fit the memory budget;"
+                      << " a few of them may have been taken for repeats and skipped" << std::endl;
+        }
     } catch (const fs::filesystem_error& e) {
         std::cerr << "Filesystem error during analysis: " << e.what() << std::endl;
     }
 
-    // Sort top lists
-    auto sort_by_size = [](const FileEntry& a, const FileEntry& b) { return a.size > b.size; };
-    auto sort_by_date_asc = [](const FileEntry& a, const FileEntry& b) { return a.last_modified < b.last_modified; };
-    auto sort_by_date_desc = [](const FileEntry& a, const FileEntry& b) { return a.last_modified > b.last_modified; };
+    stats.finalize();
 
-    // These would ideally be populated during traversal if we maintain a top-N heap
-    // but for simplicity we'll assume they were updated.
+    tree_->roll_up();
+    if (stats.sample.sampled()) {
+        SampleSummary& sample = stats.sample;
+        const auto& variance = tree_->root_variance();
+        sample.files_margin = 1.96 * std::sqrt(variance.files);
+        sample.size_margin = 1.96 * std::sqrt(variance.size);
+        const auto scanned = static_cast<double>(sample.files_scanned);
+        const auto total = static_cast<double>(stats.total_files);
+        if (scanned > 0 && total > scanned) {
+            sample.design_effect = variance.files * scanned / (total * total * (1 - scanned / total));
+        }
+    }
+    stats.largest_directories = tree_->largest(options_.top_count);
+    stats.most_populated_directories = tree_->most_populated(options_.top_count);
     
     return stats;
 }
 
-void FileSystemAnalyzer::traverse(const fs::path& path, int current_depth, DirectoryStats& stats) {
-    if (options_.max_depth != -1 && current_depth > options_.max_depth) return;
+void FileSystemAnalyzer::traverse(DirectoryTask root, DirectoryStats& stats) {
+    std::vector<DirectoryTask> pending;
+    pending.push_back(std::move(root));
+    DirectoryScan scan;
+    while (!pending.empty()) {
+        DirectoryTask task = std::move(pending.back());
+        pending.pop_back();
+        if (stop_requested()) {
+            skip_directory(task, stats);
+            continue;
+        }
+        scan.clear();
+        scan_directory(task, stats, scan);
+        std::move(scan.subdirs.begin(), scan.subdirs.end(), std::back_inserter(pending));
+    }
+}
 
-    try {
-        for (const auto& entry : fs::directory_iterator(path, fs::directory_options::skip_permission_denied)) {
-            if (options_.skip_hidden && entry.path().filename().string().front() == '.') continue;
-
-            if (fs::is_directory(entry.status())) {
-                stats.total_directories++;
-                traverse(entry.path(), current_depth + 1, stats);
-            } else if (fs::is_regular_file(entry.status())) {
-                process_file(entry.path(), stats);
+bool FileSystemAnalyzer::stop_requested() {
+    if (stopped_.load(std::memory_order_relaxed)) return true;
+    const bool cancelled = options_.cancel && options_.cancel->load(std::memory_order_relaxed);
+    if (!cancelled && (deadline_ == std::chrono::steady_clock::time_point::max() ||
+                       std::chrono::steady_clock::now() < deadline_)) {
+        return false;
+    }
+    stopped_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void FileSystemAnalyzer::skip_directory(const DirectoryTask& task, DirectoryStats& stats) {
+    // Found by its parent, so already counted as a directory; only its
+    // contents are missing.
+    stats.partial = true;
+    stats.directories_unvisited++;
+    if (stats.unvisited_directories.size() < DirectoryStats::kMaxUnvisitedListed) {
+        stats.unvisited_directories.push_back(task.path.string());
+    }
+    std::vector<DirectoryTask> none;
+    tree_->record(task.node, 0, 0, 0, none); // a streaming tree waits for every node
+}
+
+struct FileSystemAnalyzer::SampleBudget {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    uint64_t entry_limit = 0;
+    std::atomic<uint64_t> entries{0};
+
+    bool exhausted() const {
+        if (entry_limit != 0 && entries.load(std::memory_order_relaxed) >= entry_limit) return true;
+        return deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline;
+    }
+};
+
+bool FileSystemAnalyzer::sampled(const fs::path& subdir) const {
+    // Decided by the path, so one seed picks the same directories however
+    // the scan is scheduled.
+    const uint64_t hash = mix(stable_hash(subdir.native()) ^ options_.sample_seed);
+    return static_cast<double>(hash >> 11) * 0x1.0p-53 < options_.sample_fraction;
+}
+
+void FileSystemAnalyzer::traverse_sampled(DirectoryTask root, DirectoryStats& stats) {
+    // Cluster sampling, level by level. The top of the tree is scanned in
+    // full until a level is wide enough to be sampled from; there each
+    // subtree is kept with probability sample_fraction and, if kept, scanned
+    // completely. Every directory at one depth then stands for the same
+    // number of directories, so a level's totals are extrapolated with one
+    // weight. A budget can only cut the current level short; the directories
+    // it did reach are a random subset of the level, and count as such.
+    SampleBudget budget;
+    if (options_.sample_time_budget.count() > 0) budget.deadline = std::chrono::steady_clock::now() + options_.sample_time_budget;
+    budget.entry_limit = options_.sample_entry_budget;
+
+    SampleSummary& sample = stats.sample;
+    sample.fraction = options_.sample_fraction;
+    sample.seed = options_.sample_seed;
+
+    std::vector<double> rates{1.0}; // per depth, chance of a directory being scanned given its parent was
+    double weight = 1;              // directories each scanned one stands for at this depth
+    bool sampling = false;
+    std::mt19937_64 rng(options_.sample_seed);
+    std::vector<DirectoryTask> level;
+    level.push_back(std::move(root));
+    for (unsigned depth = 0; !level.empty(); ++depth) {
+        double rate = 1;
+        if (!sampling && static_cast<double>(level.size()) * options_.sample_fraction >= kMinSampledSubtrees) {
+            std::erase_if(level, [&](const DirectoryTask& task) { return !sampled(task.path); });
+            sampling = true;
+            rate = options_.sample_fraction;
+            sample.depth = depth;
+        }
+        const size_t queued = level.size();
+        std::shuffle(level.begin(), level.end(), rng);
+
+        DirectoryStats level_stats;
+        initialize_stats(level_stats);
+        std::vector<DirectoryTask> next;
+        const size_t scanned = queued == 0 ? 0 : scan_level(level, level_stats, next, budget);
+        sample.directories_scanned += scanned;
+        sample.files_scanned += level_stats.total_files;
+        if (scanned < queued) {
+            sample.complete = false;
+            if (scanned == 0) break;
+            rate *= static_cast<double>(scanned) / static_cast<double>(queued);
+        }
+        if (depth > 0) rates.push_back(rate);
+        weight /= rate;
+        level_stats.scale(weight);
+        stats.merge(level_stats);
+        sample.depth_reached = depth;
+        if (!sample.complete) break;
+        level = std::move(next);
+    }
+    tree_->sample(std::move(rates));
+}
+
+size_t FileSystemAnalyzer::scan_level(std::vector<DirectoryTask>& level, DirectoryStats& stats,
+                                      std::vector<DirectoryTask>& next, SampleBudget& budget) {
+    std::atomic<size_t> scanned{0};
+    auto scan = [&](const DirectoryTask& task, DirectoryStats& partial, std::vector<DirectoryTask>& found) {
+        if (budget.exhausted() || stop_requested()) return;
+        const uint64_t entries = partial.total_files + partial.total_directories;
+        DirectoryScan out;
+        scan_directory(task, partial, out);
+        budget.entries.fetch_add(partial.total_files + partial.total_directories - entries, std::memory_order_relaxed);
+        scanned.fetch_add(1, std::memory_order_relaxed);
+        std::move(out.subdirs.begin(), out.subdirs.end(), std::back_inserter(found));
+    };
+
+    if (options_.thread_count <= 1) {
+        for (const auto& task : level) scan(task, stats, next);
+        return scanned.load();
+    }
+
+    WorkStealingPool<DirectoryTask> pool(options_.thread_count);
+    std::vector<DirectoryStats> worker_stats(pool.worker_count());
+    std::vector<std::vector<DirectoryTask>> worker_next(pool.worker_count());
+    for (auto& partial : worker_stats) initialize_stats(partial);
+    for (size_t i = 0; i < level.size(); ++i) pool.submit(static_cast<unsigned>(i), std::move(level[i]));
+    pool.run([&](unsigned worker_id, DirectoryTask& task) { scan(task, worker_stats[worker_id], worker_next[worker_id]); });
+
+    for (unsigned id = 0; id < pool.worker_count(); ++id) {
+        stats.merge(worker_stats[id]);
+        std::move(worker_next[id].begin(), worker_next[id].end(), std::back_inserter(next));
+    }
+    return scanned.load();
+}
+
+void FileSystemAnalyzer::traverse_parallel(DirectoryTask root, DirectoryStats& stats) {
+    // Each device gets its own group of thread_count workers, so a slow
+    // mount cannot hold up the scan of the others.
+    WorkStealingPool<DirectoryTask> pool(options_.thread_count, device_groups_);
+
+    // Each worker aggregates into its own stats; no locking on the hot path.
+    std::vector<DirectoryStats> worker_stats(pool.worker_count());
+    for (auto& partial : worker_stats) initialize_stats(partial);
+
+    pool.submit(0, std::move(root));
+    pool.run([&](unsigned worker_id, DirectoryTask& task) {
+        // Once stopped, the queued tasks drain without being read.
+        if (stop_requested()) {
+            skip_directory(task, worker_stats[worker_id]);
+            return;
+        }
+        DirectoryScan scan;
+        scan_directory(task, worker_stats[worker_id], scan);
+        for (auto& subdir : scan.subdirs) {
+            const unsigned group = mounts_.empty() ? 0 : mounts_[subdir.mount].group;
+            if (group == pool.group_of(worker_id)) {
+                pool.submit(worker_id, std::move(subdir));
+            } else {
+                pool.submit_to_group(group, std::move(subdir));
             }
         }
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << "Warning: Could not access directory " << path << ": " << e.what() << std::endl;
+    });
+
+    for (const auto& partial : worker_stats) stats.merge(partial);
+}
+
+void FileSystemAnalyzer::scan_directory(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out) {
+    if (options_.on_directory) options_.on_directory(task);
+    if (options_.max_depth != -1 && task.depth > options_.max_depth) {
+        tree_->record(task.node, 0, 0, 0, out.subdirs); // a streaming tree waits for every node
+        return;
+    }
+
+    // `stats` belongs to this worker alone, so the growth of its totals is
+    // exactly what this directory holds, however it was read.
+    const uint64_t files = stats.total_files;
+    const uint64_t size = stats.total_size;
+    const uint64_t allocated_size = stats.total_allocated_size;
+    const uint64_t errors = stats.errors.total;
+    scan_directory_contents(task, stats, out);
+    // Checked here so that the path is only built for directories that failed.
+    if (stats.errors.total != errors) stats.errors.add_directory(task.path.string(), stats.errors.total - errors);
+    if (!mount_points_.empty()) enter_mounts(task, out.subdirs);
+
+    // Each subdirectory's own ignore files are loaded here, ahead of its
+    // scan, so its task (and on_directory) carries the complete rules.
+    if (options_.use_ignore_files) {
+        for (auto& subdir : out.subdirs) {
+            const bool read = options_.max_depth == -1 || subdir.depth <= options_.max_depth;
+            subdir.ignore = read ? load_ignore_frame(task.ignore, subdir.path, relative_dir(subdir.path)) : task.ignore;
+        }
+    }
+    tree_->record(task.node, stats.total_files - files, stats.total_size - size,
+                  stats.total_allocated_size - allocated_size, out.subdirs);
+    if (options_.progress) {
+        options_.progress->add_directory(stats.total_files - files, stats.total_size - size, stats.errors.total - errors);
+    }
+    if (!stats.mounts.empty()) {
+        MountSummary& mount = stats.mounts[task.mount];
+        mount.directories++;
+        mount.files += stats.total_files - files;
+        mount.size += stats.total_size - size;
+        mount.allocated_size += stats.total_allocated_size - allocated_size;
     }
 }
 
-void FileSystemAnalyzer::process_file(const fs::path& path, DirectoryStats& stats) {
-    uint64_t size = fs::file_size(path);
-    if (size < options_.min_size_threshold) return;
+void FileSystemAnalyzer::scan_directory_contents(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out) {
+    if (!cache_) {
+        scan_directory_uncached(task, stats, out);
+        return;
+    }
 
-    FileEntry entry;
-    entry.path = path;
-    entry.size = size;
-    entry.extension = path.has_extension() ? path.extension().string() : "no-extension";
-    entry.last_modified = fs::last_write_time(path);
+    FileMetadata dir;
+    std::error_code ec;
+    if (!stat_entry(kCurrentDirFd, task.path.c_str(), kFieldModTime | kFieldInode, dir, ec)) {
+        scan_directory_uncached(task, stats, out);
+        return;
+    }
+    const int64_t dir_mtime = dir.last_modified.time_since_epoch().count();
 
-    stats.total_files++;
-    stats.total_size += size;
-    
-    update_aggregation(entry, stats);
+    if (const CachedDirectory* cached = cache_->lookup(dir.device, dir.inode, dir_mtime)) {
+        // Unchanged since the last run: replay its files and descend into
+        // the recorded subdirectories without reading the directory.
+        if (cached_files_unchanged(*cached, task)) {
+            stats.merge(replay_cache_record(*cached, task));
+            for (const auto& name : cached->subdirs) out.subdirs.push_back({task.path / name, task.depth + 1});
+            return;
+        }
+        cache_->reject();
+    }
+
+    DirectoryStats partial;
+    initialize_stats(partial);
+    out.record_files = true;
+    scan_directory_uncached(task, partial, out);
+    stats.merge(partial);
+    if (!out.complete || !out.cacheable) return; // never cache a partial or link-dependent result
+
+    CachedDirectory record = make_cache_record(partial, out);
+    record.mtime = dir_mtime;
+    cache_->store(dir.device, dir.inode, std::move(record));
 }
 
-void FileSystemAnalyzer::update_aggregation(const FileEntry& entry, DirectoryStats& stats) {
-    stats.type_distribution_count[entry.extension]++;
-    stats.type_distribution_size[entry.extension] += entry.size;
+CachedDirectory FileSystemAnalyzer::make_cache_record(const DirectoryStats& partial, const DirectoryScan& scan) const {
+    CachedDirectory record;
+    record.total_files = partial.total_files;
+    record.total_directories = partial.total_directories;
+    record.total_size = partial.total_size;
+    record.total_allocated_size = partial.total_allocated_size;
+    for (uint32_t id = 0; id < partial.extensions.size(); ++id) {
+        const auto& totals = partial.extensions.totals(id);
+        const auto& histogram = partial.extensions.histogram(id);
+        CachedExtension ext{partial.extensions.name(id), totals.count, totals.size, {}, histogram.smallest(),
+                            histogram.largest()};
+        for (size_t bucket = 0; bucket < histogram.bucket_count(); ++bucket) {
+            if (histogram.bucket(bucket) == 0) continue;
+            ext.histogram.push_back(bucket);
+            ext.histogram.push_back(histogram.bucket(bucket));
+        }
+        record.extensions.push_back(std::move(ext));
+    }
+    for (const auto& range : partial.size_histogram) record.size_histogram.push_back(range.count);
+    for (const auto& range : partial.age_distribution) record.age_distribution.push_back(range.count);
+    auto flatten = [](const OwnerTable& table, std::vector<uint64_t>& out) {
+        table.for_each([&](uint32_t id, const OwnerTable::Usage& usage) {
+            out.insert(out.end(), {id, usage.files, usage.size, usage.allocated_size});
+        });
+    };
+    flatten(partial.user_usage, record.users);
+    flatten(partial.group_usage, record.groups);
+
+    // The rankings overlap heavily; storing their union is enough to rebuild
+    // each of them exactly, since merging re-ranks and truncates.
+    partial.top_files.for_each_file([&](std::string_view path, const RankedAttributes& attributes) {
+        CachedFile file;
+        file.name = path.substr(path.rfind('/') + 1);
+        file.size = attributes.size;
+        file.allocated_size = attributes.allocated_size;
+        file.mtime = attributes.last_modified.time_since_epoch().count();
+        file.atime = attributes.last_accessed.time_since_epoch().count();
+        file.ctime = attributes.last_changed.time_since_epoch().count();
+        record.top_files.push_back(std::move(file));
+    });
 
-    // Size distribution constants
-    static const std::vector<std::pair<std::string, uint64_t>> size_ranges = {
-        {"0-1KB", 1024},
-        {"1KB-1MB", 1024 * 1024},
-        {"1MB-100MB", 100 * 1024 * 1024},
-        {"100MB-1GB", 1024 * 1024 * 1024}
+    for (const auto& subdir : scan.subdirs) record.subdirs.push_back(subdir.path.filename().string());
+    for (const auto& [name, metadata] : scan.stated_files) {
+        record.files.push_back({name, metadata.inode, metadata.size, metadata.last_modified.time_since_epoch().count(),
+                                metadata.last_changed.time_since_epoch().count()});
+    }
+    const size_t oldest_bucket = partial.age_distribution.size() - 1;
+    for (auto mtime : scan.file_mtimes) {
+        if (age_bucket(mtime) < oldest_bucket) record.recent_mtimes.push_back(mtime.time_since_epoch().count());
+    }
+    return record;
+}
+
+bool FileSystemAnalyzer::cached_files_unchanged(const CachedDirectory& record, const DirectoryTask& task) const {
+    // The names are settled by the directory's mtime; what a rewrite in
+    // place changes is checked here, one stat per file, relative to the
+    // directory where the platform allows.
+    constexpr unsigned fields = kFieldType | kFieldSize | kFieldModTime | kFieldInode | kFieldChangeTime;
+    int dir_fd = kCurrentDirFd;
+    std::string path;
+#ifdef __linux__
+    dir_fd = ::open(task.path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) return false;
+#endif
+    bool unchanged = true;
+    for (const auto& file : record.files) {
+        const char* name = file.name.c_str();
+        if (dir_fd == kCurrentDirFd) {
+            path = (task.path / file.name).native();
+            name = path.c_str();
+        }
+        FileMetadata metadata;
+        std::error_code ec;
+        unchanged = stat_entry(dir_fd, name, fields, metadata, ec) && metadata.type == fs::file_type::regular &&
+                    metadata.inode == file.inode && metadata.size == file.size &&
+                    metadata.last_modified.time_since_epoch().count() == file.mtime &&
+                    metadata.last_changed.time_since_epoch().count() == file.ctime;
+        if (!unchanged) break;
+    }
+#ifdef __linux__
+    ::close(dir_fd);
+#endif
+    return unchanged;
+}
+
+DirectoryStats FileSystemAnalyzer::replay_cache_record(const CachedDirectory& record, const DirectoryTask& task) const {
+    DirectoryStats partial;
+    initialize_stats(partial);
+    partial.total_files = record.total_files;
+    partial.total_directories = record.total_directories;
+    partial.total_size = record.total_size;
+    partial.total_allocated_size = record.total_allocated_size;
+    for (const auto& ext : record.extensions) {
+        const uint32_t id = partial.extensions.intern(ext.extension);
+        partial.extensions.add_totals(id, ext.count, ext.size);
+        for (size_t i = 0; i + 1 < ext.histogram.size(); i += 2) {
+            partial.extensions.histogram(id).add_bucket(ext.histogram[i], ext.histogram[i + 1]);
+        }
+        partial.extensions.histogram(id).restore(ext.smallest, ext.largest);
+    }
+    for (size_t i = 0; i < std::min(record.size_histogram.size(), partial.size_histogram.size()); ++i) {
+        partial.size_histogram[i].count = record.size_histogram[i];
+    }
+    auto unflatten = [](const std::vector<uint64_t>& owners, OwnerTable& table) {
+        for (size_t i = 0; i + 3 < owners.size(); i += 4) {
+            table.add_totals(static_cast<uint32_t>(owners[i]), {owners[i + 1], owners[i + 2], owners[i + 3]});
+        }
     };
+    unflatten(record.users, partial.user_usage);
+    unflatten(record.groups, partial.group_usage);
+
+    // Only files that were still young last time can have changed age bucket.
+    partial.age_distribution.back().count = record.age_distribution.empty() ? 0 : record.age_distribution.back();
+    for (int64_t mtime : record.recent_mtimes) {
+        partial.age_distribution[age_bucket(fs::file_time_type(fs::file_time_type::duration(mtime)))].count++;
+    }
+
+    auto to_time = [](int64_t ticks) { return fs::file_time_type(fs::file_time_type::duration(ticks)); };
+    for (const auto& file : record.top_files) {
+        RankedAttributes attributes;
+        attributes.size = file.size;
+        attributes.allocated_size = file.allocated_size;
+        attributes.last_modified = to_time(file.mtime);
+        attributes.last_accessed = to_time(file.atime);
+        attributes.last_changed = to_time(file.ctime);
+        partial.top_files.offer((task.path / file.name).native(), attributes);
+    }
+    return partial;
+}
+
+void FileSystemAnalyzer::scan_directory_uncached(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out) {
+    if (options_.backend == TraversalBackend::Native && kNativeTraversalSupported) {
+        scan_directory_native(task, stats, out);
+    } else {
+        scan_directory_portable(task, stats, out);
+    }
+}
 
-    bool size_bucketed = false;
-    for (size_t i = 0; i < size_ranges.size(); ++i) {
-        if (entry.size < size_ranges[i].second) {
-            stats.size_histogram[i].count++;
-            size_bucketed = true;
-            break;
+std::string FileSystemAnalyzer::cache_fingerprint() const {
+    // Anything that changes which files are counted invalidates the cache.
+    return fingerprint() + ";shard=" + std::to_string(options_.shard_index) + "/" + std::to_string(options_.shard_count);
+}
+
+std::string FileSystemAnalyzer::fingerprint() const {
+    std::string patterns;
+    if (!matcher_.empty()) {
+        patterns = ";root=" + pattern_root_;
+        for (const auto& pattern : options_.include_patterns) patterns += ";include=" + pattern;
+        for (const auto& pattern : options_.exclude_patterns) patterns += ";exclude=" + pattern;
+    }
+    return "min_size=" + std::to_string(options_.min_size_threshold) +
+           ";skip_hidden=" + std::to_string(options_.skip_hidden) +
+           ";count_hard_links=" + std::to_string(options_.count_hard_links) +
+           ";follow_symlinks=" + std::to_string(options_.follow_symlinks) +
+           ";owners=" + std::to_string(options_.owner_usage) +
+           ";top=" + std::to_string(options_.top_count) + ";rankings=" + std::to_string(options_.rankings) +
+           ";histogram_precision=" + std::to_string(options_.histogram_precision) +
+           ";depth=" + std::to_string(options_.max_depth) + ";ignore_files=" + std::to_string(options_.use_ignore_files) +
+           ";one_file_system=" + std::to_string(options_.one_file_system) +
+           ";skip_pseudo=" + std::to_string(options_.skip_pseudo_filesystems) +
+           ";memory_budget=" + std::to_string(options_.memory_budget) + patterns;
+}
+
+void FileSystemAnalyzer::scan_directory_portable(const DirectoryTask& task, DirectoryStats& stats, DirectoryScan& out) {
+    const std::string_view dir = matcher_.empty() && !task.ignore ? std::string_view() : relative_dir(task.path);
+    // The error_code overloads throughout: failures are counted, and an
+    // exception per unreadable entry would cost more than the entry.
+    std::error_code read_ec;
+    fs::directory_iterator it(task.path, read_ec);
+    if (read_ec) {
+        stats.errors.add(ErrorOperation::Open, task.path, read_ec);
+        out.complete = false;
+        return;
+    }
+    for (; it != fs::directory_iterator(); it.increment(read_ec)) {
+        const fs::directory_entry& entry = *it;
+        const std::string name = entry.path().filename().string();
+        // The iterator hides its getdents reads; charge what the records
+        // of these names take.
+        if (throttle_) throttle_->pace_bytes(kDirentOverhead + name.size());
+        if (options_.skip_hidden && name.front() == '.') continue;
+
+        // directory_entry caches d_type, so these checks do not stat
+        // unless a symlink is followed. Unfollowed links are not counted.
+        std::error_code type_ec; // a dangling link or a link loop is neither
+        const bool link = entry.is_symlink(type_ec);
+        if (link && !options_.follow_symlinks) continue;
+        if (entry.is_directory(type_ec)) {
+            if (skips_directory(task, dir, name)) continue;
+            if (options_.follow_symlinks) {
+                FileMetadata metadata;
+                std::error_code ec;
+                if (!stat_entry(kCurrentDirFd, entry.path().c_str(), kFieldType | kFieldInode, metadata, ec, true)) {
+                    stats.errors.add(ErrorOperation::Stat, entry.path(), ec);
+                    out.complete = false;
+                    continue;
+                }
+                if (!first_visit(metadata, link, stats)) continue;
+            }
+            stats.total_directories++;
+            out.subdirs.push_back({entry.path(), task.depth + 1});
+        } else if (entry.is_regular_file(type_ec)) {
+            if (skips_file(task, dir, name)) continue;
+            FileMetadata metadata;
+            std::error_code ec;
+            if (!stat_entry(kCurrentDirFd, entry.path().c_str(), metadata_fields_, metadata, ec, link)) {
+                stats.errors.add(ErrorOperation::Stat, entry.path(), ec);
+                out.complete = false;
+                continue;
+            }
+            if (metadata.nlink > 1) out.cacheable = false;
+            if (out.record_files) out.stated_files.emplace_back(name, metadata);
+            if (process_file(entry.path(), metadata, stats) && out.record_files) {
+                out.file_mtimes.push_back(metadata.last_modified);
+            }
         }
     }
-    if (!size_bucketed) stats.size_histogram.back().count++;
+    if (read_ec) {
+        stats.errors.add(ErrorOperation::Read, task.path, read_ec);
+        out.complete = false;
+    }
+}
 
-    // Age distribution
-    auto now = std::chrono::system_clock::now();
-    // Approximation of file_time_type to system_clock
-    auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-        entry.last_modified - fs::file_time_type::clock::now() + now);
-    auto age_duration = now - sctp;
-    
-    if (age_duration < std::chrono::hours(24)) stats.age_distribution[0].count++;
-    else if (age_duration < std::chrono::hours(24 * 7)) stats.age_distribution[1].count++;
-    else if (age_duration < std::chrono::hours(24 * 30)) stats.age_distribution[2].count++;
-    else stats.age_distribution[3].count++;
-
-    // Top-N Lists helper
-    auto update_top_list = [](std::vector<FileEntry>& list, const FileEntry& e, auto cmp) {
-        list.push_back(e);
-        std::push_heap(list.begin(), list.end(), cmp);
-        if (list.size() > 10) {
-            std::pop_heap(list.begin(), list.end(), cmp);
-            list.pop_back();
+void FileSystemAnalyzer::scan_directory_native([[maybe_unused]] const DirectoryTask& task,
+                                               [[maybe_unused]] DirectoryStats& stats,
+                                               [[maybe_unused]] DirectoryScan& out) {
+#ifdef __linux__
+    // One reader (and its getdents buffer) per thread, reused for every directory.
+    thread_local NativeDirectoryReader reader;
+
+    // Relative to the open parent the kernel resolves one component, not
+    // the whole path. The last component is a suffix of the path string, so
+    // it is already NUL-terminated.
+    const std::string& full_path = task.path.native();
+    const int parent_fd = task.parent ? task.parent->fd() : kCurrentDirFd;
+    const char* open_name = task.parent ? full_path.c_str() + full_path.rfind('/') + 1 : full_path.c_str();
+    std::error_code ec;
+    if (!reader.open(parent_fd, open_name, ec, options_.follow_symlinks)) {
+        stats.errors.add(ErrorOperation::Open, task.path, ec);
+        out.complete = false;
+        return;
+    }
+
+    // Entries whose d_type is known are matched before they are stat'ed;
+    // DT_UNKNOWN ones once the stat has told what they are.
+    const std::string_view dir = matcher_.empty() && !task.ignore ? std::string_view() : relative_dir(task.path);
+    auto on_metadata = [&](std::string_view name, const FileMetadata& metadata, bool matched, bool through_link) {
+        if (metadata.type == fs::file_type::directory) {
+            if (!matched && skips_directory(task, dir, name)) return;
+            if (options_.follow_symlinks && !first_visit(metadata, through_link, stats)) return;
+            stats.total_directories++;
+            out.subdirs.push_back({task.path / name, task.depth + 1});
+        } else if (metadata.type == fs::file_type::regular) {
+            if (!matched && skips_file(task, dir, name)) return;
+            if (metadata.nlink > 1) out.cacheable = false;
+            if (out.record_files) out.stated_files.emplace_back(name, metadata);
+            if (process_file(task.path / name, metadata, stats) && out.record_files) {
+                out.file_mtimes.push_back(metadata.last_modified);
+            }
         }
     };
 
-    update_top_list(stats.largest_files, entry, [](const auto& a, const auto& b) { return a.size > b.size; });
-    update_top_list(stats.oldest_files, entry, [](const auto& a, const auto& b) { return a.last_modified < b.last_modified; });
-    update_top_list(stats.newest_files, entry, [](const auto& a, const auto& b) { return a.last_modified > b.last_modified; });
+    // The target of a followed link. Dangling links and link loops are
+    // skipped quietly, as unfollowed links are.
+    auto follow = [&](const char* name, FileMetadata& metadata) {
+        std::error_code link_ec;
+        if (stat_entry(reader.fd(), name, metadata_fields_, metadata, link_ec, true)) return true;
+        if (link_ec != std::errc::no_such_file_or_directory && link_ec != std::errc::too_many_symbolic_link_levels) {
+            stats.errors.add(ErrorOperation::Stat, task.path / name, link_ec);
+            out.complete = false;
+        }
+        return false;
+    };
+
+    // Batched mode: queue every stat for the directory and let io_uring keep
+    // many of them in flight. The engine degrades to sync stats by itself.
+    // One engine per worker thread and analyzer, so every scan gets a ring
+    // of its own queue depth. Ids rather than addresses: a new analyzer
+    // may reuse an old one's.
+    UringStatEngine* engine = nullptr;
+    if (options_.metadata_engine == MetadataEngine::IoUring) {
+        thread_local uint64_t engine_owner = 0;
+        thread_local std::unique_ptr<UringStatEngine> thread_engine;
+        if (engine_owner != id_) {
+            thread_engine = std::make_unique<UringStatEngine>(options_.uring_queue_depth);
+            engine_owner = id_;
+        }
+        engine = thread_engine.get();
+    }
+    thread_local PendingStats pending;
+    auto flush = [&] {
+        const auto& names = pending.finalize();
+        if (throttle_) throttle_->pace_stats(names.size());
+        const auto start = IoThrottle::Clock::now();
+        engine->stat_batch(reader.fd(), names, metadata_fields_,
+            [&](size_t index, const FileMetadata& metadata, const std::error_code& stat_ec) {
+                if (stat_ec) {
+                    stats.errors.add(ErrorOperation::Stat, task.path / names[index], stat_ec);
+                    out.complete = false;
+                    return;
+                }
+                if (metadata.type == fs::file_type::symlink && options_.follow_symlinks) {
+                    FileMetadata target;
+                    if (follow(names[index], target)) on_metadata(names[index], target, false, true);
+                    return;
+                }
+                on_metadata(names[index], metadata, pending.types[index] == DT_REG, false);
+            });
+        if (throttle_) throttle_->observe(IoThrottle::Clock::now() - start, names.size());
+        pending.clear();
+    };
+
+    RawDirEntry entry;
+    uint64_t bytes_charged = 0;
+    while (reader.next(entry, ec)) {
+        if (throttle_ && reader.bytes_read() != bytes_charged) {
+            throttle_->pace_bytes(reader.bytes_read() - bytes_charged);
+            bytes_charged = reader.bytes_read();
+        }
+        if (options_.skip_hidden && entry.name.front() == '.') continue;
+
+        // d_type answers "file or directory?" without a syscall. Directories
+        // need nothing more; regular files and DT_UNKNOWN entries get exactly
+        // one stat, whose result also settles the type of the latter. When
+        // following symlinks, directories are stat'ed too, for their inode,
+        // and links are resolved here.
+        if (entry.type == DT_LNK) {
+            if (!options_.follow_symlinks) continue;
+            FileMetadata metadata;
+            if (follow(entry.name.data(), metadata)) on_metadata(entry.name, metadata, false, true);
+            continue;
+        }
+        if (entry.type == DT_DIR && !options_.follow_symlinks) {
+            if (skips_directory(task, dir, entry.name)) continue;
+            stats.total_directories++;
+            out.subdirs.push_back({task.path / entry.name, task.depth + 1});
+            continue;
+        }
+        if (entry.type != DT_REG && entry.type != DT_UNKNOWN && entry.type != DT_DIR) continue;
+        if (entry.type == DT_REG && skips_file(task, dir, entry.name)) continue;
+
+        if (engine != nullptr) {
+            pending.add(entry.name, entry.type);
+            if (pending.offsets.size() >= PendingStats::kMaxBatch) flush();
+            continue;
+        }
+
+        FileMetadata metadata;
+        std::error_code stat_ec;
+        if (!stat_entry(reader.fd(), entry.name.data(), metadata_fields_, metadata, stat_ec)) {
+            stats.errors.add(ErrorOperation::Stat, task.path / entry.name, stat_ec);
+            out.complete = false;
+            continue;
+        }
+        const bool link = metadata.type == fs::file_type::symlink;
+        if (link && options_.follow_symlinks && !follow(entry.name.data(), metadata)) continue;
+        on_metadata(entry.name, metadata, entry.type == DT_REG, link);
+    }
+    if (engine != nullptr && !pending.offsets.empty()) flush();
+    if (ec) {
+        stats.errors.add(ErrorOperation::Read, task.path, ec);
+        out.complete = false;
+    }
+    if (!out.subdirs.empty() && DirectoryHandle::available()) {
+        auto handle = std::make_shared<const DirectoryHandle>(reader.release());
+        for (auto& subdir : out.subdirs) subdir.parent = handle;
+    } else {
+        reader.close();
+    }
+#endif
+}
+
+bool FileSystemAnalyzer::process_file(const fs::path& path, const FileMetadata& metadata, DirectoryStats& stats) {
+    uint64_t size = metadata.size;
+    if (size < options_.min_size_threshold) return false;
+
+    // Count every inode once. Which link wins is the first one reached, so
+    // with parallel workers the credited path may vary between runs; all
+    // totals and histograms are unaffected. Any file can have another path
+    // through a symlink, so when following them every file is tracked.
+    if (!options_.count_hard_links && (metadata.nlink > 1 || options_.follow_symlinks) &&
+        !linked_inodes_->insert(metadata.device, metadata.inode)) {
+        stats.hard_links_skipped++;
+        return false;
+    }
+
+    RankedAttributes attributes;
+    attributes.size = size;
+    attributes.allocated_size = metadata.blocks * 512;
+    attributes.last_modified = metadata.last_modified;
+    attributes.last_accessed = metadata.last_accessed;
+    attributes.last_changed = metadata.last_changed;
+
+    // Nothing below copies the path unless an observer asks for the entry.
+    stats.total_files++;
+    stats.total_size += size;
+    stats.total_allocated_size += attributes.allocated_size;
+    stats.extensions.add(extension_of(path), size);
+    stats.size_histogram[size_bucket(size)].count++;
+    stats.age_distribution[age_bucket(metadata.last_modified)].count++;
+    stats.top_files.offer(path.native(), attributes);
+    if (options_.owner_usage) {
+        stats.user_usage.add(metadata.uid, size, attributes.allocated_size);
+        stats.group_usage.add(metadata.gid, size, attributes.allocated_size);
+    }
+
+    if (options_.on_file) {
+        FileEntry entry;
+        entry.path = path;
+        entry.size = size;
+        entry.allocated_size = attributes.allocated_size;
+        entry.extension = extension_of(path);
+        entry.last_modified = metadata.last_modified;
+        entry.last_accessed = metadata.last_accessed;
+        entry.last_changed = metadata.last_changed;
+        entry.uid = metadata.uid;
+        entry.gid = metadata.gid;
+        options_.on_file(entry, metadata);
+    }
+    return true;
+}
+
+void FileSystemAnalyzer::update_top_lists(const FileEntry& entry, DirectoryStats& stats) const {
+    RankedAttributes attributes;
+    attributes.size = entry.size;
+    attributes.allocated_size = entry.allocated_size;
+    attributes.last_modified = entry.last_modified;
+    attributes.last_accessed = entry.last_accessed;
+    attributes.last_changed = entry.last_changed;
+    stats.top_files.offer(entry.path.native(), attributes);
+}
+
+bool FileSystemAnalyzer::add_file(const fs::path& path, const FileMetadata& metadata, DirectoryStats& stats) {
+    return process_file(path, metadata, stats);
+}
+
+bool FileSystemAnalyzer::remove_file(const FileEntry& entry, DirectoryStats& stats) const {
+    stats.total_files--;
+    stats.total_size -= entry.size;
+    stats.total_allocated_size -= entry.allocated_size;
+    stats.extensions.remove(entry.extension, entry.size);
+    stats.size_histogram[size_bucket(entry.size)].count--;
+    stats.age_distribution[age_bucket(entry.last_modified)].count--;
+    if (options_.owner_usage) {
+        stats.user_usage.remove(entry.uid, entry.size, entry.allocated_size);
+        stats.group_usage.remove(entry.gid, entry.size, entry.allocated_size);
+    }
+
+    return stats.top_files.remove(entry.path.native());
+}
+
+void FileSystemAnalyzer::reset_clock() {
+    scan_time_ = fs::file_time_type::clock::now();
+}
+
+size_t FileSystemAnalyzer::size_bucket(uint64_t size) {
+    // Upper bounds of every bucket but the last ("1GB+")
+    static constexpr uint64_t kSizeLimits[] = {1024, 1024 * 1024, 100 * 1024 * 1024, 1024 * 1024 * 1024};
+    // Bucket of the smallest value of each bit width. The limits are more
+    // than a factor of two apart, so at most one of them falls inside any
+    // width and a single compare settles the rest.
+    static constexpr auto kBucketByWidth = [] {
+        std::array<uint8_t, 65> table{};
+        for (unsigned width = 0; width < table.size(); ++width) {
+            const uint64_t lowest = width == 0 ? 0 : uint64_t{1} << (width - 1);
+            uint8_t bucket = 0;
+            while (bucket < std::size(kSizeLimits) && lowest >= kSizeLimits[bucket]) ++bucket;
+            table[width] = bucket;
+        }
+        return table;
+    }();
+
+    const size_t bucket = kBucketByWidth[std::bit_width(size)];
+    return bucket + (bucket < std::size(kSizeLimits) && size >= kSizeLimits[bucket] ? 1 : 0);
 }
 
-void FileSystemAnalyzer::initialize_histogram(DirectoryStats& stats) {
+size_t FileSystemAnalyzer::age_bucket(fs::file_time_type last_modified) const {
+    // Relative to the moment the scan started
+    const auto age_duration = scan_time_ - last_modified;
+    size_t bucket = 0;
+    while (bucket < kAgeLimits.size() && age_duration >= kAgeLimits[bucket]) bucket++;
+    return bucket;
+}
+
+void FileSystemAnalyzer::initialize_stats(DirectoryStats& stats) const {
     stats.size_histogram = {{"0-1KB"}, {"1KB-1MB"}, {"1MB-100MB"}, {"100MB-1GB"}, {"1GB+"}};
     stats.age_distribution = {{"Today"}, {"This Week"}, {"This Month"}, {"Older"}};
+    stats.top_files = TopFiles(options_.top_count, options_.rankings);
+    stats.counts_every_link = options_.count_hard_links;
+    stats.extensions = ExtensionTable(options_.histogram_precision, max_extensions_);
+    stats.mounts.clear();
+    if (mounts_.size() > 1) {
+        for (const auto& mount : mounts_) stats.mounts.push_back({mount.info.mount_point, mount.info.fs_type, mount.info.source});
+    }
+}
+
+void FileSystemAnalyzer::apply_memory_budget() {
+    max_extensions_ = 0;
+    if (options_.memory_budget == 0) return;
+
+    // A quarter for the extension tables (one per worker, plus the merged
+    // one), a quarter for the hard-link set (shared with the visited
+    // directories when following symlinks); the rest is left to the
+    // directories in flight, the top lists and the read buffers.
+    const size_t tables = options_.thread_count > 1 ? size_t{options_.thread_count} * device_groups_ + 1 : 1;
+    const size_t per_table = options_.memory_budget / 4 / tables;
+    max_extensions_ = std::max<size_t>(kMinExtensions, per_table / ExtensionTable::entry_bytes(options_.histogram_precision));
+    if (options_.follow_symlinks) {
+        linked_inodes_->limit(options_.memory_budget / 8);
+        visited_directories_->limit(options_.memory_budget / 8);
+    } else {
+        linked_inodes_->limit(options_.memory_budget / 4);
+    }
+    // A sampled tree is small, and its estimates need the whole of it.
+    if (options_.sample_fraction >= 1) tree_->stream(options_.top_count);
+}
+
+void FileSystemAnalyzer::start_throttle() {
+    throttle_.reset();
+    // Threads inherit the I/O class, so setting it here covers every worker.
+    if (options_.idle_io_priority && !set_idle_io_priority()) {
+        std::cerr << "Warning: idle I/O priority is not available here" << std::endl;
+    }
+    if (options_.max_stats_per_second > 0 || options_.max_read_bytes_per_second > 0) {
+        throttle_ = std::make_unique<IoThrottle>(IoThrottle::Limits{
+            options_.max_stats_per_second, options_.max_read_bytes_per_second, options_.latency_target});
+    }
+}
+
+bool FileSystemAnalyzer::stat_entry(int dir_fd, const char* path, unsigned fields, FileMetadata& metadata,
+                                    std::error_code& ec, bool follow_symlinks) const {
+    if (!throttle_) return read_metadata(dir_fd, path, fields, metadata, ec, follow_symlinks);
+    throttle_->pace_stats(1);
+    const auto start = IoThrottle::Clock::now();
+    const bool ok = read_metadata(dir_fd, path, fields, metadata, ec, follow_symlinks);
+    throttle_->observe(IoThrottle::Clock::now() - start, 1);
+    return ok;
+}
+
+bool FileSystemAnalyzer::first_visit(const FileMetadata& directory, bool through_link, DirectoryStats& stats) const {
+    // Mount points reached by path are settled by enter_mounts(); a link can
+    // lead anywhere, so where its target lives is checked here.
+    if (through_link && !mounts_.empty()) {
+        if (options_.one_file_system && directory.device != mounts_[0].info.device) return false;
+        if (options_.skip_pseudo_filesystems &&
+            std::find(pseudo_devices_.begin(), pseudo_devices_.end(), directory.device) != pseudo_devices_.end()) {
+            return false;
+        }
+    }
+    if (visited_directories_->insert(directory.device, directory.inode)) return true;
+    stats.directories_revisited++;
+    return false;
+}
+
+void FileSystemAnalyzer::load_mounts() {
+    mounts_.clear();
+    mount_points_.clear();
+    pseudo_devices_.clear();
+    device_groups_ = 1;
+
+    MountTable table;
+    std::error_code ec;
+    const fs::path target = fs::canonical(options_.target_path, ec);
+    if (ec || !table.load()) return;
+    for (const auto& mount : table.mounts()) {
+        if (mount.pseudo) pseudo_devices_.push_back(mount.device);
+    }
+    const MountInfo* own = table.mount_of(target.native());
+    if (own == nullptr) return;
+
+    // Mount points below the target, keyed by their path below it: the
+    // table has canonical paths, so the keys are taken from the canonical
+    // target while enter_mounts() strips the target as given, which may run
+    // through symlinks or "..". A later mount on the same point hides the
+    // earlier one.
+    mounts_.push_back({*own});
+    const std::string& prefix = target.native();
+    for (const auto& mount : table.mounts()) {
+        const std::string& point = mount.mount_point.native();
+        bool below = point.size() > prefix.size() && point.starts_with(prefix) && (prefix == "/" || point[prefix.size()] == '/');
+        if (!below) continue;
+        std::string key = point.substr(prefix.size() + (prefix == "/" ? 0 : 1));
+        auto known = std::find_if(mount_points_.begin(), mount_points_.end(), [&](const auto& entry) { return entry.first == key; });
+        if (known != mount_points_.end()) {
+            mounts_[known->second].info = mount;
+        } else {
+            mount_points_.emplace_back(std::move(key), static_cast<uint32_t>(mounts_.size()));
+            mounts_.push_back({mount});
+        }
+    }
+    std::sort(mount_points_.begin(), mount_points_.end());
+
+    // One worker group per device actually scanned; the target's is group 0.
+    std::vector<uint64_t> devices{mounts_[0].info.device};
+    for (auto& mount : mounts_) {
+        mount.skipped = (options_.skip_pseudo_filesystems && mount.info.pseudo && &mount != &mounts_[0]) ||
+                        (options_.one_file_system && mount.info.device != mounts_[0].info.device);
+        if (mount.skipped) continue;
+        auto device = std::find(devices.begin(), devices.end(), mount.info.device);
+        if (device == devices.end()) device = devices.insert(devices.end(), mount.info.device);
+        mount.group = std::min(static_cast<unsigned>(device - devices.begin()), kMaxDeviceGroups - 1);
+    }
+    device_groups_ = std::min(static_cast<unsigned>(devices.size()), kMaxDeviceGroups);
+}
+
+void FileSystemAnalyzer::enter_mounts(const DirectoryTask& task, std::vector<DirectoryTask>& subdirs) const {
+    std::erase_if(subdirs, [&](DirectoryTask& subdir) {
+        subdir.mount = task.mount;
+        // Every scanned path is the target as given with names appended.
+        std::string_view key = subdir.path.native();
+        if (key.starts_with(options_.target_path.native())) key.remove_prefix(options_.target_path.native().size());
+        while (key.starts_with('/')) key.remove_prefix(1);
+        auto it = std::lower_bound(mount_points_.begin(), mount_points_.end(), key,
+                                   [](const auto& entry, std::string_view k) { return entry.first < k; });
+        if (it == mount_points_.end() || it->first != key) return false;
+        subdir.mount = it->second;
+        return mounts_[it->second].skipped;
+    });
 }
 
 } // namespace analyzer
@@ -0,0 +1,79 @@
+#include "IgnoreRules.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace analyzer {
+
+namespace {
+
+// Read in this order; later rules win, so .ignore overrides .gitignore.
+constexpr const char* kIgnoreFiles[] = {".gitignore", ".ignore"};
+
+} // namespace
+
+bool is_ignore_file(std::string_view name) {
+    return std::find(std::begin(kIgnoreFiles), std::end(kIgnoreFiles), name) != std::end(kIgnoreFiles);
+}
+
+void IgnoreRules::parse(std::string_view text) {
+    while (!text.empty()) {
+        auto newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+
+        if (line.ends_with('\r')) line.remove_suffix(1);
+        // Trailing blanks are dropped unless escaped ("foo\ ").
+        while (line.ends_with(' ') && !line.ends_with("\\ ")) line.remove_suffix(1);
+        if (line.empty() || line.front() == '#') continue;
+
+        bool negated = line.front() == '!';
+        if (negated) line.remove_prefix(1);
+
+        if (runs_.empty() || runs_.back().negated != negated) {
+            runs_.emplace_back();
+            runs_.back().negated = negated;
+        }
+        Run& run = runs_.back();
+        (GlobSet::is_directory_pattern(line) ? run.directories : run.any).add(line);
+    }
+}
+
+IgnoreRules::Verdict IgnoreRules::match(std::string_view dir, std::string_view name, bool is_directory) const {
+    for (auto run = runs_.rbegin(); run != runs_.rend(); ++run) {
+        if (run->any.matches(dir, name) || (is_directory && run->directories.matches(dir, name))) {
+            return run->negated ? Verdict::Keep : Verdict::Ignore;
+        }
+    }
+    return Verdict::None;
+}
+
+std::shared_ptr<const IgnoreFrame> load_ignore_frame(std::shared_ptr<const IgnoreFrame> parent, const fs::path& path,
+                                                     std::string_view base) {
+    std::shared_ptr<IgnoreFrame> frame;
+    for (const char* name : kIgnoreFiles) {
+        std::ifstream file(path / name, std::ios::binary);
+        if (!file) continue;
+        std::string text(std::istreambuf_iterator<char>(file), {});
+        if (!frame) frame = std::make_shared<IgnoreFrame>();
+        frame->rules.parse(text);
+    }
+    if (!frame || frame->rules.empty()) return parent;
+
+    frame->parent = std::move(parent);
+    frame->base = base;
+    return frame;
+}
+
+bool is_ignored(const IgnoreFrame* frame, std::string_view dir, std::string_view name, bool is_directory) {
+    for (; frame != nullptr; frame = frame->parent.get()) {
+        // Frames are ancestors of `dir`, so their base is a prefix of it.
+        std::string_view local = dir.substr(std::min(frame->base.size(), dir.size()));
+        if (local.starts_with('/')) local.remove_prefix(1);
+        auto verdict = frame->rules.match(local, name, is_directory);
+        if (verdict != IgnoreRules::Verdict::None) return verdict == IgnoreRules::Verdict::Ignore;
+    }
+    return false;
+}
+
+} // namespace analyzer
@@ -0,0 +1,106 @@
+#include "InodeSet.hpp"
+#include <algorithm>
+
+namespace analyzer {
+
+namespace {
+
+constexpr size_t kInitialSlots = 1024; // per shard, power of two
+constexpr int kSketchHashes = 4;       // about 2% false positives at 8 bits per pair
+
+size_t floor_power_of_two(size_t n) {
+    size_t power = 1;
+    while (power <= n / 2) power *= 2;
+    return power;
+}
+
+} // namespace
+
+InodeSet::InodeSet(size_t shard_count) {
+    if (shard_count == 0) shard_count = 1;
+    for (size_t i = 0; i < shard_count; ++i) shards_.push_back(std::make_unique<Shard>());
+}
+
+void InodeSet::limit(size_t max_bytes) {
+    // Half for the exact slots, which briefly exist twice over while a
+    // shard grows, and a quarter for the filter.
+    max_slots_ = std::max(kInitialSlots, floor_power_of_two(max_bytes / 2 / shards_.size() / sizeof(Slot)));
+    const size_t bits = floor_power_of_two(std::max<size_t>(max_bytes / 4 * 8, 64));
+    sketch_ = std::make_unique<std::atomic<uint64_t>[]>(bits / 64);
+    sketch_mask_ = bits - 1;
+}
+
+bool InodeSet::insert_sketch(uint64_t h) {
+    // Double hashing: probe i is h1 + i * h2.
+    const uint64_t h1 = h;
+    const uint64_t h2 = (h >> 32 | h << 32) | 1;
+    bool present = true;
+    for (int i = 0; i < kSketchHashes; ++i) {
+        const uint64_t bit = (h1 + static_cast<uint64_t>(i) * h2) & sketch_mask_;
+        const uint64_t mask = uint64_t{1} << (bit & 63);
+        if (!(sketch_[bit >> 6].fetch_or(mask, std::memory_order_relaxed) & mask)) present = false;
+    }
+    if (!present) sketched_.fetch_add(1, std::memory_order_relaxed);
+    return !present;
+}
+
+uint64_t InodeSet::hash(uint64_t device, uint64_t inode) {
+    // splitmix64 finalizer over both halves of the key
+    uint64_t x = inode ^ (device * 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+void InodeSet::place(std::vector<Slot>& slots, const Slot& slot, uint64_t h) {
+    const size_t mask = slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        if (slots[i].device == 0 && slots[i].inode == 0) {
+            slots[i] = slot;
+            return;
+        }
+    }
+}
+
+void InodeSet::grow(Shard& shard) {
+    std::vector<Slot> bigger(shard.slots.empty() ? kInitialSlots : shard.slots.size() * 2);
+    for (const auto& slot : shard.slots) {
+        if (slot.device != 0 || slot.inode != 0) place(bigger, slot, hash(slot.device, slot.inode));
+    }
+    shard.slots.swap(bigger);
+}
+
+bool InodeSet::insert(uint64_t device, uint64_t inode) {
+    const uint64_t h = hash(device, inode);
+    // High bits pick the shard, low bits the slot, so the two stay independent.
+    Shard& shard = *shards_[(h >> 48) % shards_.size()];
+
+    std::lock_guard lock(shard.mutex);
+    // Keep the load factor under 70% so probe chains stay short.
+    if ((shard.count + 1) * 10 > shard.slots.size() * 7 && shard.slots.size() < max_slots_) grow(shard);
+    const bool at_limit = (shard.count + 1) * 10 > shard.slots.size() * 7;
+
+    const size_t mask = shard.slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        Slot& slot = shard.slots[i];
+        if (slot.device == device && slot.inode == inode) return false;
+        if (slot.device == 0 && slot.inode == 0) {
+            // Not among the exact pairs; past the limit, the filter decides.
+            if (at_limit) return insert_sketch(h);
+            slot = {device, inode};
+            shard.count++;
+            return true;
+        }
+    }
+}
+
+size_t InodeSet::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        total += shard->count;
+    }
+    return total;
+}
+
+} // namespace analyzer
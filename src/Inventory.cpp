@@ -0,0 +1,504 @@
+#include "Inventory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+
+namespace analyzer {
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'S', 'A', 'I', 'N', 'V', '1', '\n'};
+constexpr uint8_t kDirectoryFlag = 1;
+constexpr uint8_t kEndFlag = 0x80; // trailer: record count follows
+constexpr size_t kWriteChunk = 64 * 1024;
+// Extensions tracked separately by diff; the rest are summed under
+// kOtherExtensions, as in a scan under a memory budget.
+constexpr size_t kMaxDiffExtensions = 65536;
+
+std::atomic<uint64_t> next_writer_id{1};
+
+void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool get_varint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        const int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) return false;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool by_path(const InventoryRecord& a, const InventoryRecord& b) {
+    return inventory_order(a.path, b.path);
+}
+
+// Front-codes sorted records into one inventory file.
+class RecordEncoder {
+public:
+    bool open(const fs::path& file, const std::string& root) {
+        out_.open(file, std::ios::binary | std::ios::trunc);
+        if (!out_.is_open()) return false;
+        pending_.append(kMagic, sizeof(kMagic));
+        put_varint(pending_, root.size());
+        pending_ += root;
+        return true;
+    }
+
+    void write(const InventoryRecord& record) {
+        if (count_ > 0 && record.path == previous_) return; // reported twice; keep the first
+        const size_t limit = std::min(previous_.size(), record.path.size());
+        size_t shared = 0;
+        while (shared < limit && previous_[shared] == record.path[shared]) ++shared;
+        put_varint(pending_, shared);
+        put_varint(pending_, record.path.size() - shared);
+        pending_.append(record.path, shared);
+        pending_.push_back(static_cast<char>(record.directory ? kDirectoryFlag : 0));
+        if (!record.directory) {
+            put_varint(pending_, record.size);
+            put_varint(pending_, record.allocated_size);
+            put_varint(pending_, zigzag(record.mtime));
+        }
+        previous_ = record.path;
+        ++count_;
+        if (pending_.size() >= kWriteChunk) flush();
+    }
+
+    bool close() {
+        put_varint(pending_, 0);
+        put_varint(pending_, 0);
+        pending_.push_back(static_cast<char>(kEndFlag));
+        put_varint(pending_, count_);
+        flush();
+        out_.close();
+        return !out_.fail();
+    }
+
+private:
+    void flush() {
+        out_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+        pending_.clear();
+    }
+
+    std::ofstream out_;
+    std::string pending_;
+    std::string previous_;
+    uint64_t count_ = 0;
+};
+
+bool within(std::string_view path, std::string_view dir) {
+    return dir.empty() || (path.size() > dir.size() && path.starts_with(dir) && path[dir.size()] == '/');
+}
+
+uint64_t magnitude(const PathChange& change) {
+    return change.new_size > change.old_size ? change.new_size - change.old_size : change.old_size - change.new_size;
+}
+
+// Largest change first, ties by path so the lists do not depend on order.
+bool ranks_ahead(const PathChange& a, const PathChange& b) {
+    if (magnitude(a) != magnitude(b)) return magnitude(a) > magnitude(b);
+    return a.path < b.path;
+}
+
+void offer(ChangeSet& set, size_t n, PathChange change) {
+    ++set.count;
+    set.bytes += magnitude(change);
+    if (n == 0) return;
+    if (set.largest.size() == n) {
+        if (!ranks_ahead(change, set.largest.front())) return;
+        std::pop_heap(set.largest.begin(), set.largest.end(), ranks_ahead);
+        set.largest.back() = std::move(change);
+    } else {
+        set.largest.push_back(std::move(change));
+    }
+    std::push_heap(set.largest.begin(), set.largest.end(), ranks_ahead);
+}
+
+// What one path looked like in the old and in the new inventory.
+struct DiffEvent {
+    const InventoryRecord* old_record = nullptr;
+    const InventoryRecord* new_record = nullptr;
+};
+
+class Differ {
+public:
+    Differ(size_t top_n, InventoryDiff& diff) : top_n_(top_n), diff_(diff) {}
+
+    void add(DiffEvent event) {
+        const InventoryRecord& any = event.old_record ? *event.old_record : *event.new_record;
+        while (!open_.empty() && !within(any.path, open_.back().path)) close();
+        if (any.directory) {
+            open_.push_back({any.path, event.old_record != nullptr, event.new_record != nullptr});
+            if (!any.path.empty()) {
+                if (event.old_record) ++diff_.old_directories;
+                if (event.new_record) ++diff_.new_directories;
+            }
+        } else {
+            add_file(event);
+        }
+    }
+
+    void finish() {
+        while (!open_.empty()) close();
+        for (auto* sets : {&diff_.files, &diff_.directories}) {
+            for (auto& set : *sets) std::sort_heap(set.largest.begin(), set.largest.end(), ranks_ahead);
+        }
+
+        for (auto& [extension, change] : extensions_) {
+            if (change.old_count == change.new_count && change.old_size == change.new_size) continue;
+            change.extension = extension;
+            diff_.extensions.push_back(std::move(change));
+        }
+        auto growth = [](const ExtensionChange& change) {
+            return static_cast<double>(change.new_size) - static_cast<double>(change.old_size);
+        };
+        std::sort(diff_.extensions.begin(), diff_.extensions.end(), [&](const ExtensionChange& a, const ExtensionChange& b) {
+            if (growth(a) != growth(b)) return growth(a) > growth(b);
+            return a.extension < b.extension;
+        });
+    }
+
+private:
+    struct OpenDirectory {
+        std::string path;
+        bool in_old = false;
+        bool in_new = false;
+        uint64_t old_size = 0; // recursive, so far
+        uint64_t new_size = 0;
+    };
+
+    void record(std::array<ChangeSet, kChangeKinds>& sets, bool in_old, bool in_new, PathChange change) {
+        Change kind;
+        if (!in_old) {
+            kind = Change::Appeared;
+        } else if (!in_new) {
+            kind = Change::Disappeared;
+        } else if (change.new_size > change.old_size) {
+            kind = Change::Grew;
+        } else if (change.new_size < change.old_size) {
+            kind = Change::Shrank;
+        } else {
+            return;
+        }
+        offer(sets[static_cast<size_t>(kind)], top_n_, std::move(change));
+    }
+
+    void close() {
+        OpenDirectory done = std::move(open_.back());
+        open_.pop_back();
+        if (open_.empty()) return; // the root: its totals are the summary
+        open_.back().old_size += done.old_size;
+        open_.back().new_size += done.new_size;
+        record(diff_.directories, done.in_old, done.in_new, {std::move(done.path), done.old_size, done.new_size});
+    }
+
+    void add_file(const DiffEvent& event) {
+        const InventoryRecord* old_file = event.old_record;
+        const InventoryRecord* new_file = event.new_record;
+        const std::string& path = (old_file ? old_file : new_file)->path;
+        const uint64_t old_size = old_file ? old_file->size : 0;
+        const uint64_t new_size = new_file ? new_file->size : 0;
+        if (old_file) {
+            ++diff_.old_files;
+            diff_.old_size += old_size;
+            diff_.old_allocated_size += old_file->allocated_size;
+        }
+        if (new_file) {
+            ++diff_.new_files;
+            diff_.new_size += new_size;
+            diff_.new_allocated_size += new_file->allocated_size;
+        }
+        if (old_file && new_file && old_size == new_size && old_file->mtime != new_file->mtime) ++diff_.files_modified;
+        if (!open_.empty()) {
+            open_.back().old_size += old_size;
+            open_.back().new_size += new_size;
+        }
+
+        std::string_view extension = extension_of(std::string_view(path));
+        auto it = extensions_.find(std::string(extension));
+        if (it == extensions_.end()) {
+            if (extensions_.size() >= kMaxDiffExtensions) extension = kOtherExtensions;
+            it = extensions_.try_emplace(std::string(extension)).first;
+        }
+        ExtensionChange& totals = it->second;
+        if (old_file) {
+            ++totals.old_count;
+            totals.old_size += old_size;
+        }
+        if (new_file) {
+            ++totals.new_count;
+            totals.new_size += new_size;
+        }
+
+        record(diff_.files, old_file != nullptr, new_file != nullptr, {path, old_size, new_size});
+    }
+
+    size_t top_n_;
+    InventoryDiff& diff_;
+    std::vector<OpenDirectory> open_; // the directories along the current path, root first
+    std::unordered_map<std::string, ExtensionChange> extensions_;
+};
+
+} // namespace
+
+bool inventory_order(std::string_view a, std::string_view b) {
+    const size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] == b[i]) continue;
+        // The separator sorts before every other byte.
+        if (a[i] == '/') return true;
+        if (b[i] == '/') return false;
+        return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[i]);
+    }
+    return a.size() < b.size();
+}
+
+InventoryWriter::InventoryWriter(fs::path file, const fs::path& root, size_t buffer_bytes)
+    : id_(next_writer_id.fetch_add(1, std::memory_order_relaxed)), file_(std::move(file)), root_(root.native()),
+      buffer_bytes_(buffer_bytes) {
+    while (root_.size() > 1 && root_.back() == '/') root_.pop_back();
+    if (root_ == "/") root_.clear();
+}
+
+InventoryWriter::~InventoryWriter() {
+    std::error_code ec;
+    for (const auto& run : runs_) fs::remove(run, ec);
+}
+
+std::string InventoryWriter::relative(const fs::path& path) const {
+    std::string_view rest = path.native();
+    if (rest.starts_with(root_)) rest.remove_prefix(root_.size());
+    while (rest.starts_with('/')) rest.remove_prefix(1);
+    return std::string(rest);
+}
+
+void InventoryWriter::add_file(const FileEntry& entry) {
+    add({relative(entry.path), false, entry.size, entry.allocated_size, entry.last_modified.time_since_epoch().count()});
+}
+
+void InventoryWriter::add_directory(const fs::path& path) {
+    add({relative(path), true});
+}
+
+void InventoryWriter::add(InventoryRecord record) {
+    Batch& batch = local();
+    batch.bytes += sizeof(InventoryRecord) + record.path.capacity();
+    batch.records.push_back(std::move(record));
+    if (batch.records.size() >= kBatchRecords) hand_over(batch);
+}
+
+InventoryWriter::Batch& InventoryWriter::local() {
+    // Ids rather than addresses: a new writer may reuse an old one's.
+    thread_local uint64_t owner = 0;
+    thread_local Batch* batch = nullptr;
+    if (owner != id_) {
+        std::lock_guard lock(mutex_);
+        batches_.push_back(std::make_unique<Batch>());
+        batch = batches_.back().get();
+        owner = id_;
+    }
+    return *batch;
+}
+
+void InventoryWriter::take(Batch& batch) {
+    buffered_bytes_ += batch.bytes;
+    std::move(batch.records.begin(), batch.records.end(), std::back_inserter(buffer_));
+    batch.records.clear();
+    batch.bytes = 0;
+}
+
+void InventoryWriter::hand_over(Batch& batch) {
+    std::vector<InventoryRecord> full;
+    fs::path run;
+    {
+        std::unique_lock lock(mutex_);
+        take(batch);
+        if (buffered_bytes_ < buffer_bytes_ / 2) return;
+        spilled_.wait(lock, [this] { return !spilling_; });
+        // Another thread may have taken the buffer while this one waited.
+        if (buffered_bytes_ < buffer_bytes_ / 2) return;
+        spilling_ = true;
+        full.swap(buffer_);
+        buffered_bytes_ = 0;
+        run = next_run();
+    }
+
+    const bool written = write_run(run, full);
+    {
+        std::lock_guard lock(mutex_);
+        spilling_ = false;
+        if (!written) failed_ = true;
+    }
+    spilled_.notify_all();
+}
+
+fs::path InventoryWriter::next_run() {
+    fs::path run = file_;
+    run += ".run" + std::to_string(runs_.size());
+    runs_.push_back(run);
+    return run;
+}
+
+bool InventoryWriter::write_run(const fs::path& run, std::vector<InventoryRecord>& records) const {
+    std::sort(records.begin(), records.end(), by_path);
+    RecordEncoder encoder;
+    if (!encoder.open(run, root_)) return false;
+    for (const auto& record : records) encoder.write(record);
+    return encoder.close();
+}
+
+bool InventoryWriter::finish() {
+    std::unique_lock lock(mutex_);
+    spilled_.wait(lock, [this] { return !spilling_; });
+    if (failed_) return false;
+    // The scan is over, so no thread still adds to its batch.
+    for (auto& batch : batches_) take(*batch);
+
+    // Same write-and-rename as the scan cache: a reader never sees half a file.
+    fs::path temp = file_;
+    temp += ".tmp";
+    RecordEncoder encoder;
+    if (!encoder.open(temp, root_)) return false;
+
+    if (runs_.empty()) {
+        std::sort(buffer_.begin(), buffer_.end(), by_path);
+        for (const auto& record : buffer_) encoder.write(record);
+    } else {
+        if (!buffer_.empty() && !write_run(next_run(), buffer_)) return false;
+        std::vector<InventoryReader> readers(runs_.size());
+        std::vector<InventoryRecord> heads(runs_.size());
+        auto later = [&](size_t a, size_t b) { return by_path(heads[b], heads[a]); };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> queue(later);
+        for (size_t i = 0; i < runs_.size(); ++i) {
+            if (!readers[i].open(runs_[i])) return false;
+            if (readers[i].next(heads[i])) queue.push(i);
+        }
+        while (!queue.empty()) {
+            const size_t i = queue.top();
+            queue.pop();
+            encoder.write(heads[i]);
+            if (readers[i].next(heads[i])) queue.push(i);
+        }
+        for (const auto& reader : readers) {
+            if (reader.failed()) return false;
+        }
+    }
+    buffer_.clear();
+    if (!encoder.close()) return false;
+
+    std::error_code ec;
+    fs::rename(temp, file_, ec);
+    return !ec;
+}
+
+bool InventoryReader::open(const fs::path& file) {
+    file_ = file;
+    in_.open(file, std::ios::binary);
+    if (!in_.is_open()) {
+        std::cerr << "Warning: Could not open inventory " << file << std::endl;
+        return false;
+    }
+    char magic[sizeof(kMagic)] = {};
+    uint64_t length = 0;
+    if (!in_.read(magic, sizeof(magic)) || !std::equal(std::begin(magic), std::end(magic), std::begin(kMagic)) ||
+        !get_varint(in_, length)) {
+        std::cerr << "Warning: " << file << " is not an inventory of this version" << std::endl;
+        return false;
+    }
+    root_.resize(length);
+    if (!in_.read(root_.data(), static_cast<std::streamsize>(length))) {
+        std::cerr << "Warning: " << file << " is not an inventory of this version" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool InventoryReader::next(InventoryRecord& record) {
+    if (failed_ || !in_.is_open()) return false;
+    uint64_t shared = 0;
+    uint64_t suffix = 0;
+    int flags = std::char_traits<char>::eof();
+    if (get_varint(in_, shared) && get_varint(in_, suffix) && shared <= path_.size()) {
+        path_.resize(shared + suffix);
+        if (in_.read(path_.data() + shared, static_cast<std::streamsize>(suffix))) flags = in_.get();
+    }
+
+    if (flags == kEndFlag) {
+        in_.close();
+        return false;
+    }
+    uint64_t size = 0;
+    uint64_t allocated_size = 0;
+    uint64_t mtime = 0;
+    const bool directory = flags == kDirectoryFlag;
+    if (flags == std::char_traits<char>::eof() || (flags & ~kDirectoryFlag) != 0 ||
+        (!directory && !(get_varint(in_, size) && get_varint(in_, allocated_size) && get_varint(in_, mtime)))) {
+        std::cerr << "Warning: Inventory " << file_ << " is truncated or damaged" << std::endl;
+        failed_ = true;
+        return false;
+    }
+    record.path = path_;
+    record.directory = directory;
+    record.size = size;
+    record.allocated_size = allocated_size;
+    record.mtime = unzigzag(mtime);
+    return true;
+}
+
+bool diff_inventories(const fs::path& old_file, const fs::path& new_file, size_t top_n, InventoryDiff& diff) {
+    InventoryReader old_inventory;
+    InventoryReader new_inventory;
+    if (!old_inventory.open(old_file) || !new_inventory.open(new_file)) return false;
+    diff.old_root = old_inventory.root();
+    diff.new_root = new_inventory.root();
+
+    Differ differ(top_n, diff);
+    InventoryRecord old_record;
+    InventoryRecord new_record;
+    bool has_old = old_inventory.next(old_record);
+    bool has_new = new_inventory.next(new_record);
+    while (has_old || has_new) {
+        if (has_old && has_new && old_record.path == new_record.path) {
+            if (old_record.directory == new_record.directory) {
+                differ.add({&old_record, &new_record});
+            } else if (new_record.directory) {
+                // Replaced by the other kind: the file goes first, ahead of what is below the directory.
+                differ.add({&old_record, nullptr});
+                differ.add({nullptr, &new_record});
+            } else {
+                differ.add({nullptr, &new_record});
+                differ.add({&old_record, nullptr});
+            }
+            has_old = old_inventory.next(old_record);
+            has_new = new_inventory.next(new_record);
+        } else if (has_old && (!has_new || inventory_order(old_record.path, new_record.path))) {
+            differ.add({&old_record, nullptr});
+            has_old = old_inventory.next(old_record);
+        } else {
+            differ.add({nullptr, &new_record});
+            has_new = new_inventory.next(new_record);
+        }
+    }
+    differ.finish();
+    return !old_inventory.failed() && !new_inventory.failed();
+}
+
+} // namespace analyzer
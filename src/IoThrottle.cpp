@@ -0,0 +1,88 @@
+#include "IoThrottle.hpp"
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace analyzer {
+
+namespace {
+
+// Unused rate saved up while the scan was busy elsewhere; lets short
+// pauses pay for themselves without allowing long bursts.
+constexpr IoThrottle::Clock::duration kBurst = std::chrono::milliseconds(100);
+// Pacing changes at most this often, so one slow stat cannot halve it twice.
+constexpr IoThrottle::Clock::duration kAdjustInterval = std::chrono::milliseconds(100);
+constexpr double kAverageWeight = 0.05;
+constexpr double kBaselineDrift = 0.001;
+constexpr double kAutomaticTargetFactor = 4.0;
+constexpr double kMinScale = 1.0 / 64;
+constexpr double kRecoveryStep = 0.05;
+
+} // namespace
+
+IoThrottle::IoThrottle(Limits limits) : latency_target_(limits.latency_target) {
+    stats_.rate = limits.stats_per_second;
+    bytes_.rate = limits.bytes_per_second;
+}
+
+void IoThrottle::pace(Bucket& bucket, double amount) {
+    if (bucket.rate <= 0 || amount <= 0) return;
+    Clock::time_point wake;
+    {
+        std::lock_guard lock(mutex_);
+        const auto now = Clock::now();
+        bucket.next = std::max(bucket.next, now - kBurst);
+        bucket.next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(amount / (bucket.rate * scale_)));
+        wake = bucket.next;
+    }
+    std::this_thread::sleep_until(wake);
+}
+
+void IoThrottle::observe(Clock::duration elapsed, uint64_t count) {
+    if (count == 0) return;
+    const double per_operation = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+                                 static_cast<double>(count);
+
+    std::lock_guard lock(mutex_);
+    average_ns_ = average_ns_ == 0 ? per_operation : average_ns_ + (per_operation - average_ns_) * kAverageWeight;
+    if (baseline_ns_ == 0 || average_ns_ < baseline_ns_) {
+        baseline_ns_ = average_ns_;
+    } else {
+        baseline_ns_ += (average_ns_ - baseline_ns_) * kBaselineDrift;
+    }
+
+    const auto now = Clock::now();
+    if (now - last_adjustment_ < kAdjustInterval) return;
+    last_adjustment_ = now;
+
+    const double target = latency_target_.count() > 0 ? static_cast<double>(latency_target_.count())
+                                                       : baseline_ns_ * kAutomaticTargetFactor;
+    if (average_ns_ > target) {
+        scale_ = std::max(kMinScale, scale_ / 2);
+    } else {
+        scale_ = std::min(1.0, scale_ + kRecoveryStep);
+    }
+}
+
+double IoThrottle::scale() const {
+    std::lock_guard lock(mutex_);
+    return scale_;
+}
+
+bool set_idle_io_priority() {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    // From linux/ioprio.h, which is not always installed.
+    constexpr int kWhoProcess = 1;
+    constexpr int kClassIdle = 3;
+    constexpr int kClassShift = 13;
+    return ::syscall(SYS_ioprio_set, kWhoProcess, 0, kClassIdle << kClassShift) == 0;
+#else
+    return false;
+#endif
+}
+
+} // namespace analyzer
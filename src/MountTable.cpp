@@ -0,0 +1,96 @@
+#include "MountTable.hpp"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+namespace analyzer {
+
+namespace {
+
+// Filesystems whose files are generated by the kernel. Scanning them costs
+// time, can block (autofs triggers mounts) and reports sizes that are not
+// disk usage.
+constexpr std::string_view kPseudoFilesystems[] = {
+    "autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs", "debugfs", "devpts", "devtmpfs",
+    "efivarfs", "fusectl", "hugetlbfs", "mqueue", "nsfs", "proc", "pstore", "rpc_pipefs", "securityfs",
+    "selinuxfs", "sysfs", "tracefs",
+};
+
+// mountinfo escapes space, tab, newline and backslash as \ooo.
+std::string unescape(std::string_view field) {
+    std::string out;
+    out.reserve(field.size());
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            int value = 0;
+            bool octal = true;
+            for (size_t j = i + 1; j <= i + 3; ++j) {
+                if (field[j] < '0' || field[j] > '7') octal = false;
+                value = value * 8 + (field[j] - '0');
+            }
+            if (octal) {
+                out.push_back(static_cast<char>(value));
+                i += 3;
+                continue;
+            }
+        }
+        out.push_back(field[i]);
+    }
+    return out;
+}
+
+} // namespace
+
+bool MountTable::load(const fs::path& mountinfo) {
+    mounts_.clear();
+    std::ifstream file(mountinfo);
+    if (!file) return false;
+
+    // "36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue"
+    // Fields 3 and 5 are the device and mount point; the filesystem type and
+    // source follow the "-" that ends the optional fields.
+    for (std::string line; std::getline(file, line);) {
+        std::istringstream fields(line);
+        std::string id, parent, device, root, mount_point, options, field;
+        if (!(fields >> id >> parent >> device >> root >> mount_point >> options)) continue;
+        while (fields >> field && field != "-") {}
+        MountInfo mount;
+        if (!(fields >> mount.fs_type)) continue;
+        fields >> mount.source;
+
+        uint64_t major = 0, minor = 0;
+        const char* end = device.data() + device.size();
+        auto parsed = std::from_chars(device.data(), end, major);
+        if (parsed.ec != std::errc() || parsed.ptr == end || *parsed.ptr != ':') continue;
+        if (std::from_chars(parsed.ptr + 1, end, minor).ec != std::errc()) continue;
+        mount.device = (major << 32) | minor;
+        mount.mount_point = unescape(mount_point);
+        mount.source = unescape(mount.source);
+        mount.pseudo = is_pseudo_fs(mount.fs_type);
+        mounts_.push_back(std::move(mount));
+    }
+    return !mounts_.empty();
+}
+
+const MountInfo* MountTable::mount_of(std::string_view path) const {
+    // Longest mount point that is `path` or one of its ancestors; the last
+    // mount wins among equals, as it is the one on top.
+    const MountInfo* best = nullptr;
+    size_t best_length = 0;
+    for (const auto& mount : mounts_) {
+        std::string_view point = mount.mount_point.native();
+        bool contains = point == "/" || path == point || (path.starts_with(point) && path[point.size()] == '/');
+        if (contains && point.size() >= best_length) {
+            best = &mount;
+            best_length = point.size();
+        }
+    }
+    return best;
+}
+
+bool MountTable::is_pseudo_fs(std::string_view fs_type) {
+    return std::find(std::begin(kPseudoFilesystems), std::end(kPseudoFilesystems), fs_type) != std::end(kPseudoFilesystems);
+}
+
+} // namespace analyzer
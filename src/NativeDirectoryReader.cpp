@@ -0,0 +1,132 @@
+#include "NativeDirectoryReader.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace analyzer {
+
+#ifdef __linux__
+
+namespace {
+
+// Layout returned by SYS_getdents64; glibc only exposes it on newer versions.
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1]; // really d_reclen - 19 bytes, NUL-terminated
+};
+
+} // namespace
+
+NativeDirectoryReader::NativeDirectoryReader(size_t buffer_size) : buffer_(buffer_size) {}
+
+NativeDirectoryReader::~NativeDirectoryReader() { close(); }
+
+bool NativeDirectoryReader::open(int parent_fd, const char* name, std::error_code& ec, bool follow_symlinks) {
+    close();
+    fd_ = ::openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow_symlinks ? 0 : O_NOFOLLOW));
+    if (fd_ < 0) {
+        ec.assign(errno, std::generic_category());
+        return false;
+    }
+    offset_ = length_ = 0;
+    bytes_read_ = 0;
+    return true;
+}
+
+bool NativeDirectoryReader::refill(std::error_code& ec) {
+    long n;
+    do {
+        n = ::syscall(SYS_getdents64, fd_, buffer_.data(), buffer_.size());
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        ec.assign(errno, std::generic_category());
+        return false;
+    }
+    offset_ = 0;
+    length_ = static_cast<size_t>(n);
+    bytes_read_ += length_;
+    return n > 0;
+}
+
+bool NativeDirectoryReader::next(RawDirEntry& entry, std::error_code& ec) {
+    while (true) {
+        if (offset_ >= length_ && !refill(ec)) return false;
+
+        const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer_.data() + offset_);
+        offset_ += dirent->d_reclen;
+
+        const char* name = dirent->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        entry.name = std::string_view(name, std::strlen(name));
+        entry.type = dirent->d_type;
+        entry.inode = dirent->d_ino;
+        return true;
+    }
+}
+
+void NativeDirectoryReader::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int NativeDirectoryReader::release() {
+    const int fd = fd_;
+    fd_ = -1;
+    return fd;
+}
+
+DirectoryHandle::~DirectoryHandle() {
+    ::close(fd_);
+    open_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool DirectoryHandle::available() {
+    static const size_t limit = [] {
+        struct rlimit limits;
+        if (::getrlimit(RLIMIT_NOFILE, &limits) != 0 || limits.rlim_cur == RLIM_INFINITY) return size_t{512};
+        return static_cast<size_t>(limits.rlim_cur / 2);
+    }();
+    return open_.load(std::memory_order_relaxed) < limit;
+}
+
+#else
+
+NativeDirectoryReader::NativeDirectoryReader(size_t buffer_size) : buffer_(buffer_size) {}
+NativeDirectoryReader::~NativeDirectoryReader() = default;
+
+bool NativeDirectoryReader::open(int, const char*, std::error_code& ec, bool) {
+    ec = std::make_error_code(std::errc::function_not_supported);
+    return false;
+}
+
+bool NativeDirectoryReader::next(RawDirEntry&, std::error_code& ec) {
+    ec = std::make_error_code(std::errc::function_not_supported);
+    return false;
+}
+
+void NativeDirectoryReader::close() { offset_ = length_ = 0; }
+int NativeDirectoryReader::release() { return -1; }
+
+DirectoryHandle::~DirectoryHandle() { open_.fetch_sub(1, std::memory_order_relaxed); }
+bool DirectoryHandle::available() { return false; }
+
+#endif
+
+std::atomic<size_t> DirectoryHandle::open_{0};
+
+DirectoryHandle::DirectoryHandle(int fd) : fd_(fd) { open_.fetch_add(1, std::memory_order_relaxed); }
+
+} // namespace analyzer
@@ -0,0 +1,112 @@
+#include "OwnerTable.hpp"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <grp.h>
+#include <pwd.h>
+#include <unistd.h>
+#define ANALYZER_HAVE_PASSWD 1
+#endif
+
+namespace analyzer {
+
+namespace {
+
+constexpr size_t kInitialIds = 1024;
+constexpr size_t kNameBuffer = 16 * 1024; // enough for any sane passwd/group entry
+
+struct NameCache {
+    std::mutex mutex;
+    std::unordered_map<uint32_t, std::string> names;
+};
+
+// Resolves through `lookup` (getpwuid_r or getgrgid_r) on first use only:
+// those go through NSS and can mean a network round trip per call.
+template <typename Lookup>
+std::string cached_name(NameCache& cache, uint32_t id, Lookup lookup) {
+    std::lock_guard lock(cache.mutex);
+    auto it = cache.names.find(id);
+    if (it == cache.names.end()) {
+        std::string name = lookup(id);
+        it = cache.names.emplace(id, name.empty() ? std::to_string(id) : std::move(name)).first;
+    }
+    return it->second;
+}
+
+} // namespace
+
+OwnerTable::Usage& OwnerTable::slot(uint32_t id) {
+    if (id >= kDenseIds) return sparse_[id];
+    dense_.resize(std::max<size_t>({kInitialIds, dense_.size() * 2, size_t{id} + 1}));
+    if (dense_.size() > kDenseIds) dense_.resize(kDenseIds);
+    return dense_[id];
+}
+
+void OwnerTable::remove(uint32_t id, uint64_t size, uint64_t allocated_size) {
+    Usage& usage = id < dense_.size() ? dense_[id] : slot(id);
+    usage.files--;
+    usage.size -= size;
+    usage.allocated_size -= allocated_size;
+}
+
+void OwnerTable::add_totals(uint32_t id, const Usage& totals) {
+    Usage& usage = id < dense_.size() ? dense_[id] : slot(id);
+    usage.files += totals.files;
+    usage.size += totals.size;
+    usage.allocated_size += totals.allocated_size;
+}
+
+void OwnerTable::merge(const OwnerTable& other) {
+    other.for_each([this](uint32_t id, const Usage& usage) { add_totals(id, usage); });
+}
+
+void OwnerTable::scale(double weight) {
+    auto scaled = [weight](uint64_t value) {
+        return static_cast<uint64_t>(std::llround(static_cast<double>(value) * weight));
+    };
+    auto apply = [&](Usage& usage) {
+        usage.files = scaled(usage.files);
+        usage.size = scaled(usage.size);
+        usage.allocated_size = scaled(usage.allocated_size);
+    };
+    for (auto& usage : dense_) apply(usage);
+    for (auto& [id, usage] : sparse_) apply(usage);
+}
+
+std::string user_name(uint32_t uid) {
+    static NameCache cache;
+    return cached_name(cache, uid, [](uint32_t id) -> std::string {
+#ifdef ANALYZER_HAVE_PASSWD
+        struct passwd entry;
+        struct passwd* found = nullptr;
+        std::vector<char> buffer(kNameBuffer);
+        if (::getpwuid_r(static_cast<uid_t>(id), &entry, buffer.data(), buffer.size(), &found) == 0 && found) {
+            return found->pw_name;
+        }
+#else
+        (void)id;
+#endif
+        return {};
+    });
+}
+
+std::string group_name(uint32_t gid) {
+    static NameCache cache;
+    return cached_name(cache, gid, [](uint32_t id) -> std::string {
+#ifdef ANALYZER_HAVE_PASSWD
+        struct group entry;
+        struct group* found = nullptr;
+        std::vector<char> buffer(kNameBuffer);
+        if (::getgrgid_r(static_cast<gid_t>(id), &entry, buffer.data(), buffer.size(), &found) == 0 && found) {
+            return found->gr_name;
+        }
+#else
+        (void)id;
+#endif
+        return {};
+    });
+}
+
+} // namespace analyzer
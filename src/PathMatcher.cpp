@@ -0,0 +1,208 @@
+#include "PathMatcher.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace analyzer {
+
+std::vector<GlobSet::Segment> GlobSet::compile(std::string_view pattern, bool& anchored) {
+    while (!pattern.empty() && pattern.back() == '/') pattern.remove_suffix(1);
+    anchored = pattern.find('/') != std::string_view::npos;
+
+    std::vector<Segment> segments;
+    while (!pattern.empty()) {
+        auto slash = pattern.find('/');
+        std::string_view text = pattern.substr(0, slash);
+        pattern = slash == std::string_view::npos ? std::string_view() : pattern.substr(slash + 1);
+        if (text.empty()) continue; // leading or doubled slash
+
+        Segment segment;
+        if (text == "**") {
+            segment.any_depth = true;
+            if (segments.empty() || !segments.back().any_depth) segments.push_back(std::move(segment));
+            continue;
+        }
+        for (size_t i = 0; i < text.size(); ++i) {
+            Token token;
+            if (text[i] == '\\' && i + 1 < text.size()) {
+                token.c = text[++i];
+            } else if (text[i] == '*') {
+                if (!segment.tokens.empty() && segment.tokens.back().kind == Token::Star) continue;
+                token.kind = Token::Star;
+            } else if (text[i] == '?') {
+                token.kind = Token::Any;
+            } else if (text[i] == '[') {
+                size_t first = i + 1;
+                bool negate = first < text.size() && (text[first] == '!' || text[first] == '^');
+                if (negate) first++;
+                size_t close = text.find(']', first + 1); // "[]a]": a leading ']' is a member
+                if (close == std::string_view::npos) {
+                    token.c = text[i];
+                } else {
+                    token.kind = Token::Class;
+                    for (size_t j = first; j < close; ++j) {
+                        auto low = static_cast<unsigned char>(text[j]);
+                        auto high = low;
+                        if (j + 2 < close && text[j + 1] == '-') {
+                            high = static_cast<unsigned char>(text[j + 2]);
+                            j += 2;
+                        }
+                        for (unsigned c = low; c <= high; ++c) token.set.set(c);
+                    }
+                    if (negate) token.set.flip();
+                    i = close;
+                }
+            } else {
+                token.c = text[i];
+            }
+            segment.tokens.push_back(std::move(token));
+        }
+        segments.push_back(std::move(segment));
+    }
+
+    // "**/name" is the same as "name": any depth.
+    if (segments.size() == 2 && segments[0].any_depth && !segments[1].any_depth) {
+        segments.erase(segments.begin());
+        anchored = false;
+    }
+    return segments;
+}
+
+bool GlobSet::add(std::string_view pattern) {
+    bool anchored = false;
+    auto segments = compile(pattern, anchored);
+    if (segments.empty()) return false;
+
+    count_++;
+    if (anchored || segments[0].any_depth) {
+        path_globs_.push_back(std::move(segments));
+        return true;
+    }
+
+    auto& tokens = segments[0].tokens;
+    auto all_literal = [](auto first, auto last) {
+        return std::all_of(first, last, [](const Token& t) { return t.kind == Token::Literal; });
+    };
+    auto literal_text = [](auto first, auto last) {
+        std::string text;
+        for (auto it = first; it != last; ++it) text.push_back(it->c);
+        return text;
+    };
+    auto star = std::find_if(tokens.begin(), tokens.end(), [](const Token& t) { return t.kind == Token::Star; });
+    if (star == tokens.end() && all_literal(tokens.begin(), tokens.end())) {
+        names_.insert(literal_text(tokens.begin(), tokens.end()));
+    } else if (star == tokens.begin() && all_literal(tokens.begin() + 1, tokens.end())) {
+        std::string suffix = literal_text(tokens.begin() + 1, tokens.end());
+        if (suffix.size() > 1 && suffix.rfind('.') == 0) {
+            extensions_.insert(std::move(suffix));
+        } else {
+            suffixes_.push_back(std::move(suffix));
+        }
+    } else if (star == tokens.end() - 1 && all_literal(tokens.begin(), star)) {
+        prefixes_.push_back(literal_text(tokens.begin(), star));
+    } else {
+        name_globs_.push_back(std::move(tokens));
+    }
+    return true;
+}
+
+bool GlobSet::matches(std::string_view dir, std::string_view name) const {
+    if (count_ == 0) return false;
+    if (!names_.empty() && names_.contains(name)) return true;
+    if (!extensions_.empty()) {
+        auto dot = name.rfind('.');
+        if (dot != std::string_view::npos && extensions_.contains(name.substr(dot))) return true;
+    }
+    for (const auto& suffix : suffixes_) {
+        if (name.ends_with(suffix)) return true;
+    }
+    for (const auto& prefix : prefixes_) {
+        if (name.starts_with(prefix)) return true;
+    }
+    for (const auto& glob : name_globs_) {
+        if (match_component(glob, name)) return true;
+    }
+    if (path_globs_.empty()) return false;
+
+    thread_local std::vector<std::string_view> components;
+    components.clear();
+    while (!dir.empty()) {
+        auto slash = dir.find('/');
+        components.push_back(dir.substr(0, slash));
+        dir = slash == std::string_view::npos ? std::string_view() : dir.substr(slash + 1);
+    }
+    components.push_back(name);
+    for (const auto& glob : path_globs_) {
+        if (match_path(glob, components)) return true;
+    }
+    return false;
+}
+
+bool GlobSet::match_component(const std::vector<Token>& tokens, std::string_view text) {
+    // Greedy with a single backtrack point: on a mismatch, let the last star
+    // swallow one more character. Linear for patterns with one star.
+    size_t t = 0, i = 0;
+    size_t star_t = std::string_view::npos, star_i = 0;
+    while (i < text.size()) {
+        if (t < tokens.size()) {
+            const Token& token = tokens[t];
+            if (token.kind == Token::Star) {
+                star_t = ++t;
+                star_i = i;
+                continue;
+            }
+            bool hit = token.kind == Token::Any || (token.kind == Token::Literal && token.c == text[i]) ||
+                       (token.kind == Token::Class && token.set.test(static_cast<unsigned char>(text[i])));
+            if (hit) {
+                t++;
+                i++;
+                continue;
+            }
+        }
+        if (star_t == std::string_view::npos) return false;
+        t = star_t;
+        i = ++star_i;
+    }
+    while (t < tokens.size() && tokens[t].kind == Token::Star) t++;
+    return t == tokens.size();
+}
+
+bool GlobSet::match_path(const std::vector<Segment>& segments, const std::vector<std::string_view>& components) {
+    // Same scheme one level up: "**" plays the star, components the characters.
+    size_t s = 0, i = 0;
+    size_t star_s = std::string_view::npos, star_i = 0;
+    while (i < components.size()) {
+        if (s < segments.size()) {
+            if (segments[s].any_depth) {
+                star_s = ++s;
+                star_i = i;
+                continue;
+            }
+            if (match_component(segments[s].tokens, components[i])) {
+                s++;
+                i++;
+                continue;
+            }
+        }
+        if (star_s == std::string_view::npos) return false;
+        s = star_s;
+        i = ++star_i;
+    }
+    while (s < segments.size() && segments[s].any_depth) s++;
+    return s == segments.size();
+}
+
+PathMatcher::PathMatcher(const std::vector<std::string>& include, const std::vector<std::string>& exclude) {
+    for (const auto& pattern : include) {
+        if (GlobSet::is_directory_pattern(pattern) || !include_.add(pattern)) {
+            std::cerr << "Warning: include pattern '" << pattern << "' never matches a file, ignored" << std::endl;
+        }
+    }
+    for (const auto& pattern : exclude) {
+        auto& set = GlobSet::is_directory_pattern(pattern) ? exclude_directories_ : exclude_;
+        if (!set.add(pattern)) std::cerr << "Warning: empty exclude pattern ignored" << std::endl;
+    }
+    filters_files_ = !include_.empty() || !exclude_.empty();
+    filters_directories_ = !exclude_.empty() || !exclude_directories_.empty();
+}
+
+} // namespace analyzer
@@ -2,6 +2,8 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <nlohmann/json.hpp>
 
 namespace analyzer {
@@ -21,54 +23,183 @@ std::string TextReportGenerator::format_size(uint64_t bytes) const {
     return oss.str();
 }
 
+std::string TextReportGenerator::format_change(uint64_t old_size, uint64_t new_size) const {
+    return (new_size >= old_size ? "+" : "-") + format_size(new_size >= old_size ? new_size - old_size : old_size - new_size);
+}
+
 std::string TextReportGenerator::generate_fs_report(const DirectoryStats& stats) const {
     std::ostringstream oss;
     oss << "========================================\n";
     oss << "      FILE SYSTEM ANALYSIS REPORT       \n";
     oss << "========================================\n\n";
     
+    // Sampled figures are estimates; each gets its 95% margin.
+    const SampleSummary& sample = stats.sample;
+    auto count_margin = [&](uint64_t count) {
+        if (!sample.sampled()) return std::string();
+        return " +/- " + std::to_string(std::llround(sample.count_margin(count, stats.total_files)));
+    };
+
     oss << "Summary:\n";
-    oss << "  Total Files:       " << stats.total_files << "\n";
+    oss << "  Total Files:       " << stats.total_files;
+    if (sample.sampled()) oss << " +/- " << std::llround(sample.files_margin);
+    oss << "\n";
     oss << "  Total Directories: " << stats.total_directories << "\n";
-    oss << "  Total Size:        " << format_size(stats.total_size) << "\n\n";
+    oss << "  Total Size:        " << format_size(stats.total_size);
+    if (sample.sampled()) oss << " +/- " << format_size(static_cast<uint64_t>(sample.size_margin));
+    oss << "\n";
+    oss << "  Disk Usage:        " << format_size(stats.total_allocated_size) << "\n";
+    if (stats.hard_links_skipped > 0) {
+        oss << "  Hard Links Skipped: " << stats.hard_links_skipped << "\n";
+    }
+    if (stats.counts_every_link) {
+        oss << "  Hard Links:        each link counted as a file (a default fs scan counts each inode once)\n";
+    }
+    if (stats.directories_revisited > 0) {
+        oss << "  Directories Revisited: " << stats.directories_revisited << " (reached again through symlinks, skipped)\n";
+    }
+    const ErrorSummary& errors = stats.errors;
+    if (errors.total > 0) {
+        oss << "  Read Errors:       " << errors.total << " in " << errors.directories << " directories\n";
+        for (const auto& [code, count] : errors.by_code) {
+            oss << "    " << std::left << std::setw(30) << ErrorSummary::message(code) << std::right << std::setw(10) << count << "\n";
+        }
+    }
+    if (stats.partial) {
+        oss << "  PARTIAL: the scan was stopped early; " << stats.directories_unvisited
+            << " directories were not read and their contents are missing from every figure\n";
+    }
+    oss << "\n";
+
+    if (!stats.unvisited_directories.empty()) {
+        oss << "Unvisited Directories";
+        if (stats.directories_unvisited > stats.unvisited_directories.size()) {
+            oss << " (" << stats.unvisited_directories.size() << " of " << stats.directories_unvisited << ")";
+        }
+        oss << ":\n";
+        for (const auto& dir : stats.unvisited_directories) oss << "  " << dir << "\n";
+        oss << "\n";
+    }
+
+    if (errors.total > 0) {
+        oss << "Directories With Most Read Errors:\n";
+        for (const auto& dir : errors.worst_directories) {
+            oss << "  " << std::right << std::setw(10) << dir.errors << "  " << dir.path << "\n";
+        }
+        oss << "\nUnreadable Entries";
+        if (errors.total > errors.samples.size()) oss << " (" << errors.samples.size() << " of " << errors.total << ")";
+        oss << ":\n";
+        for (const auto& sample : errors.samples) {
+            oss << "  " << std::left << std::setw(5) << operation_name(sample.operation) << std::right << " " << sample.path
+                << ": " << ErrorSummary::message(sample.code) << "\n";
+        }
+        oss << "\n";
+    }
+
+    if (sample.sampled()) {
+        oss << "Sampling:\n";
+        oss << "  Fraction:          " << sample.fraction << " of the subtrees at depth " << sample.depth << " (seed "
+            << sample.seed << ")\n";
+        oss << "  Scanned:           " << sample.directories_scanned << " directories, " << sample.files_scanned << " files\n";
+        oss << "  Design Effect:     " << std::fixed << std::setprecision(1) << sample.design_effect << std::defaultfloat
+            << std::setprecision(6) << "\n";
+        oss << "  Figures are extrapolated; +/- gives 95% confidence margins.\n";
+        if (!sample.complete) {
+            oss << "  Stopped early (budget, time limit or interrupt) at depth " << sample.depth_reached
+                << "; deeper directories were not reached, so totals are low.\n";
+        }
+        oss << "\n";
+    }
 
     oss << "File Type Distribution (Top 10):\n";
     std::vector<std::pair<std::string, uint64_t>> types(stats.type_distribution_count.begin(), stats.type_distribution_count.end());
     std::sort(types.begin(), types.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
     
     for (size_t i = 0; i < std::min(types.size(), size_t(10)); ++i) {
-        oss << "  " << std::left << std::setw(15) << types[i].first << ": " << types[i].second << " files (" 
-            << format_size(stats.type_distribution_size.at(types[i].first)) << ")\n";
+        oss << "  " << std::left << std::setw(15) << types[i].first << ": " << types[i].second << count_margin(types[i].second)
+            << " files (" << format_size(stats.type_distribution_size.at(types[i].first)) << ")\n";
     }
     oss << "\n";
 
     oss << "Size Distribution:\n";
     for (const auto& range : stats.size_histogram) {
-        oss << "  " << std::left << std::setw(15) << range.label << ": " << range.count << " files\n";
+        oss << "  " << std::left << std::setw(15) << range.label << ": " << range.count << count_margin(range.count) << " files\n";
+    }
+    oss << "\n";
+
+    oss << "Size Percentiles (p50 / p90 / p99):\n";
+    auto percentile_line = [&](const std::string& label, const SizePercentiles& p) {
+        oss << "  " << std::left << std::setw(15) << label << ": " << format_size(p.p50) << " / "
+            << format_size(p.p90) << " / " << format_size(p.p99) << "\n";
+    };
+    percentile_line("All files", stats.size_percentiles);
+    for (size_t i = 0; i < std::min(types.size(), size_t(10)); ++i) {
+        percentile_line(types[i].first, stats.type_size_percentiles.at(types[i].first));
     }
     oss << "\n";
 
     oss << "Age Distribution:\n";
     for (const auto& range : stats.age_distribution) {
-        oss << "  " << std::left << std::setw(15) << range.label << ": " << range.count << " files\n";
+        oss << "  " << std::left << std::setw(15) << range.label << ": " << range.count << count_margin(range.count) << " files\n";
     }
     oss << "\n";
 
     oss << "Largest Files:\n";
-    auto largest = stats.largest_files;
-    std::sort(largest.begin(), largest.end(), [](const auto& a, const auto& b) { return a.size > b.size; });
-    for (const auto& entry : largest) {
+    for (const auto& entry : stats.largest_files) {
         oss << "  " << format_size(entry.size) << "  " << entry.path.string() << "\n";
     }
     oss << "\n";
 
     oss << "Oldest Files:\n";
-    auto oldest = stats.oldest_files;
-    std::sort(oldest.begin(), oldest.end(), [](const auto& a, const auto& b) { return a.last_modified < b.last_modified; });
-    for (const auto& entry : oldest) {
+    for (const auto& entry : stats.oldest_files) {
         oss << "  " << entry.path.string() << "\n";
     }
 
+    if (!stats.least_accessed_files.empty()) {
+        oss << "\nLeast Recently Accessed Files:\n";
+        for (const auto& entry : stats.least_accessed_files) {
+            oss << "  " << entry.path.string() << "\n";
+        }
+    }
+    if (!stats.recently_changed_files.empty()) {
+        oss << "\nRecently Changed Files:\n";
+        for (const auto& entry : stats.recently_changed_files) {
+            oss << "  " << entry.path.string() << "\n";
+        }
+    }
+
+    if (!stats.largest_directories.empty()) {
+        oss << "\nLargest Directories:\n";
+        for (const auto& dir : stats.largest_directories) {
+            oss << "  " << std::right << std::setw(10) << format_size(dir.size) << "  " << dir.path.string() << "\n";
+        }
+    }
+    if (!stats.most_populated_directories.empty()) {
+        oss << "\nMost Populated Directories:\n";
+        for (const auto& dir : stats.most_populated_directories) {
+            oss << "  " << std::right << std::setw(10) << dir.files << "  " << dir.path.string() << "\n";
+        }
+    }
+    if (!stats.mounts.empty()) {
+        oss << "\nMounts:\n";
+        for (const auto& mount : stats.mounts) {
+            oss << "  " << std::right << std::setw(10) << format_size(mount.size) << "  " << std::setw(10) << mount.files
+                << " files  " << mount.mount_point.string() << " (" << mount.fs_type << ", " << mount.source << ")\n";
+        }
+    }
+    auto owners = [&](const char* title, const std::vector<OwnerSummary>& list) {
+        if (list.empty()) return;
+        oss << "\n" << title << " (Top 10):\n";
+        for (size_t i = 0; i < std::min(list.size(), size_t(10)); ++i) {
+            const auto& owner = list[i];
+            oss << "  " << std::left << std::setw(15) << owner.name << ": " << std::right << std::setw(10)
+                << format_size(owner.size) << " in " << owner.files << " files (" << format_size(owner.allocated_size)
+                << " on disk)\n";
+        }
+    };
+    owners("Users", stats.users);
+    owners("Groups", stats.groups);
+
     return oss.str();
 }
 
@@ -118,17 +249,159 @@ std::string TextReportGenerator::generate_log_report(const LogSummary& summary)
     return oss.str();
 }
 
+std::string TextReportGenerator::generate_dup_report(const DuplicateReport& report) const {
+    std::ostringstream oss;
+    oss << "========================================\n";
+    oss << "        DUPLICATE FILES REPORT          \n";
+    oss << "========================================\n\n";
+
+    oss << "Summary:\n";
+    oss << "  Files Scanned:     " << report.files_scanned << "\n";
+    oss << "  Same-Size Files:   " << report.size_candidates << "\n";
+    oss << "  Head/Tail Matches: " << report.partial_candidates << "\n";
+    oss << "  Data Read:         " << format_size(report.bytes_read) << "\n";
+    if (report.scan_errors > 0) {
+        oss << "  Scan Errors:       " << report.scan_errors << " (entries that could not be listed or stat'ed)\n";
+    }
+    if (report.unreadable_files > 0) {
+        oss << "  Unreadable Files:  " << report.unreadable_files << "\n";
+    }
+    oss << "  Duplicate Sets:    " << report.sets.size() << "\n";
+    oss << "  Reclaimable:       " << format_size(report.reclaimable_bytes) << "\n\n";
+
+    if (!report.unreadable_samples.empty()) {
+        oss << "Unreadable Files";
+        if (report.unreadable_files > report.unreadable_samples.size()) {
+            oss << " (" << report.unreadable_samples.size() << " of " << report.unreadable_files << ")";
+        }
+        oss << ":\n";
+        for (const auto& path : report.unreadable_samples) oss << "  " << path.string() << "\n";
+        oss << "\n";
+    }
+
+    for (const auto& set : report.sets) {
+        oss << set.paths.size() << " copies of " << format_size(set.size) << " ("
+            << format_size(set.reclaimable_bytes()) << " reclaimable):\n";
+        for (const auto& path : set.paths) {
+            oss << "  " << path.string() << "\n";
+        }
+    }
+
+    return oss.str();
+}
+
+std::string TextReportGenerator::generate_diff_report(const InventoryDiff& diff) const {
+    static constexpr std::array<const char*, kChangeKinds> kNames = {"Appeared", "Disappeared", "Grew", "Shrank"};
+    std::ostringstream oss;
+    oss << "========================================\n";
+    oss << "         INVENTORY DIFF REPORT          \n";
+    oss << "========================================\n\n";
+
+    oss << "Summary:\n";
+    oss << "  Old:               " << diff.old_root << " (" << diff.old_files << " files, " << diff.old_directories
+        << " directories, " << format_size(diff.old_size) << ")\n";
+    oss << "  New:               " << diff.new_root << " (" << diff.new_files << " files, " << diff.new_directories
+        << " directories, " << format_size(diff.new_size) << ")\n";
+    oss << "  Size Change:       " << format_change(diff.old_size, diff.new_size) << "\n";
+    oss << "  Disk Usage Change: " << format_change(diff.old_allocated_size, diff.new_allocated_size) << "\n";
+    oss << "  Files Modified:    " << diff.files_modified << " (same size)\n\n";
+
+    auto changes = [&](const char* kind, const std::array<ChangeSet, kChangeKinds>& sets) {
+        oss << kind << ":\n";
+        for (size_t i = 0; i < kChangeKinds; ++i) {
+            oss << "  " << std::left << std::setw(12) << kNames[i] << ": " << sets[i].count << " ("
+                << (i == static_cast<size_t>(Change::Disappeared) || i == static_cast<size_t>(Change::Shrank) ? "-" : "+")
+                << format_size(sets[i].bytes) << ")\n";
+        }
+        for (size_t i = 0; i < kChangeKinds; ++i) {
+            if (sets[i].largest.empty()) continue;
+            oss << "\n" << kind << " " << kNames[i] << ":\n";
+            for (const auto& change : sets[i].largest) {
+                oss << "  " << std::right << std::setw(11) << format_change(change.old_size, change.new_size) << "  "
+                    << change.path << "\n";
+            }
+        }
+        oss << "\n";
+    };
+    changes("Files", diff.files);
+    changes("Directories", diff.directories);
+
+    oss << "Extension Growth (Top 10):\n";
+    for (size_t i = 0; i < std::min(diff.extensions.size(), size_t(10)); ++i) {
+        const auto& ext = diff.extensions[i];
+        const int64_t files = static_cast<int64_t>(ext.new_count) - static_cast<int64_t>(ext.old_count);
+        oss << "  " << std::left << std::setw(15) << ext.extension << ": " << format_change(ext.old_size, ext.new_size)
+            << " (" << (files >= 0 ? "+" : "") << files << " files)\n";
+    }
+
+    return oss.str();
+}
+
 std::string JsonReportGenerator::generate_fs_report(const DirectoryStats& stats) const {
     json j;
     j["summary"]["total_files"] = stats.total_files;
     j["summary"]["total_directories"] = stats.total_directories;
     j["summary"]["total_size"] = stats.total_size;
+    j["summary"]["total_allocated_size"] = stats.total_allocated_size;
+    j["summary"]["hard_links_skipped"] = stats.hard_links_skipped;
+    j["summary"]["counts_every_link"] = stats.counts_every_link;
+    j["summary"]["directories_revisited"] = stats.directories_revisited;
+    j["summary"]["errors"] = {{"total", stats.errors.total}, {"directories", stats.errors.directories}};
+    json by_code = json::array();
+    for (const auto& [code, count] : stats.errors.by_code) {
+        by_code.push_back({{"errno", code}, {"message", ErrorSummary::message(code)}, {"count", count}});
+    }
+    j["summary"]["errors"]["by_errno"] = std::move(by_code);
+    json worst = json::array();
+    for (const auto& dir : stats.errors.worst_directories) worst.push_back({{"path", dir.path}, {"errors", dir.errors}});
+    j["summary"]["errors"]["worst_directories"] = std::move(worst);
+    json samples = json::array();
+    for (const auto& sample : stats.errors.samples) {
+        samples.push_back({{"path", sample.path}, {"operation", operation_name(sample.operation)}, {"errno", sample.code},
+                           {"message", ErrorSummary::message(sample.code)}});
+    }
+    j["summary"]["errors"]["samples"] = std::move(samples);
+    j["summary"]["partial"] = stats.partial;
+    if (stats.partial) {
+        j["summary"]["directories_unvisited"] = stats.directories_unvisited;
+        j["unvisited_directories"] = stats.unvisited_directories;
+    }
     
     j["type_distribution"] = stats.type_distribution_count;
+
+    const SampleSummary& sample = stats.sample;
+    if (sample.sampled()) {
+        j["sample"] = {
+            {"fraction", sample.fraction},
+            {"seed", sample.seed},
+            {"depth", sample.depth},
+            {"directories_scanned", sample.directories_scanned},
+            {"files_scanned", sample.files_scanned},
+            {"complete", sample.complete},
+            {"depth_reached", sample.depth_reached},
+            {"design_effect", sample.design_effect},
+            {"total_files_margin", sample.files_margin},
+            {"total_size_margin", sample.size_margin}
+        };
+        // 95% margins of the extrapolated counts
+        for (const auto& [extension, count] : stats.type_distribution_count) {
+            j["sample"]["type_distribution_margin"][extension] = sample.count_margin(count, stats.total_files);
+        }
+        for (const auto& range : stats.size_histogram) {
+            j["sample"]["size_distribution_margin"][range.label] = sample.count_margin(range.count, stats.total_files);
+        }
+    }
     
     for (const auto& range : stats.size_histogram) {
         j["size_distribution"][range.label] = range.count;
     }
+
+    auto percentiles = [](const SizePercentiles& p) { return json{{"p50", p.p50}, {"p90", p.p90}, {"p99", p.p99}}; };
+    j["size_percentiles"]["overall"] = percentiles(stats.size_percentiles);
+    j["size_percentiles"]["by_extension"] = json::object();
+    for (const auto& [extension, p] : stats.type_size_percentiles) {
+        j["size_percentiles"]["by_extension"][extension] = percentiles(p);
+    }
     
     for (const auto& entry : stats.largest_files) {
         j["largest_files"].push_back({
@@ -137,7 +410,60 @@ std::string JsonReportGenerator::generate_fs_report(const DirectoryStats& stats)
             {"extension", entry.extension}
         });
     }
+
+    auto directories = [](const std::vector<DirectorySummary>& list) {
+        json array = json::array();
+        for (const auto& dir : list) {
+            array.push_back({
+                {"path", dir.path.string()},
+                {"files", dir.files},
+                {"size", dir.size},
+                {"allocated_size", dir.allocated_size}
+            });
+        }
+        return array;
+    };
+    auto files = [](const std::vector<FileEntry>& list) {
+        json array = json::array();
+        for (const auto& entry : list) array.push_back({{"path", entry.path.string()}, {"size", entry.size}});
+        return array;
+    };
+    if (!stats.least_accessed_files.empty()) j["least_accessed_files"] = files(stats.least_accessed_files);
+    if (!stats.recently_changed_files.empty()) j["recently_changed_files"] = files(stats.recently_changed_files);
+
+    j["largest_directories"] = directories(stats.largest_directories);
+    j["most_populated_directories"] = directories(stats.most_populated_directories);
+    if (!stats.mounts.empty()) {
+        j["mounts"] = json::array();
+        for (const auto& mount : stats.mounts) {
+            j["mounts"].push_back({
+                {"mount_point", mount.mount_point.string()},
+                {"fs_type", mount.fs_type},
+                {"source", mount.source},
+                {"directories", mount.directories},
+                {"files", mount.files},
+                {"size", mount.size},
+                {"allocated_size", mount.allocated_size}
+            });
+        }
+    }
     
+    auto owners = [](const std::vector<OwnerSummary>& list) {
+        json array = json::array();
+        for (const auto& owner : list) {
+            array.push_back({
+                {"id", owner.id},
+                {"name", owner.name},
+                {"files", owner.files},
+                {"size", owner.size},
+                {"allocated_size", owner.allocated_size}
+            });
+        }
+        return array;
+    };
+    if (!stats.users.empty()) j["users"] = owners(stats.users);
+    if (!stats.groups.empty()) j["groups"] = owners(stats.groups);
+
     return j.dump(4);
 }
 
@@ -155,4 +481,69 @@ std::string JsonReportGenerator::generate_log_report(const LogSummary& summary)
     return j.dump(4);
 }
 
+std::string JsonReportGenerator::generate_dup_report(const DuplicateReport& report) const {
+    json j;
+    j["summary"]["files_scanned"] = report.files_scanned;
+    j["summary"]["size_candidates"] = report.size_candidates;
+    j["summary"]["partial_candidates"] = report.partial_candidates;
+    j["summary"]["bytes_read"] = report.bytes_read;
+    j["summary"]["scan_errors"] = report.scan_errors;
+    j["summary"]["unreadable_files"] = report.unreadable_files;
+    j["unreadable_files"] = json::array();
+    for (const auto& path : report.unreadable_samples) j["unreadable_files"].push_back(path.string());
+    j["summary"]["reclaimable_bytes"] = report.reclaimable_bytes;
+
+    j["duplicate_sets"] = json::array();
+    for (const auto& set : report.sets) {
+        json paths = json::array();
+        for (const auto& path : set.paths) paths.push_back(path.string());
+        j["duplicate_sets"].push_back({
+            {"size", set.size},
+            {"reclaimable_bytes", set.reclaimable_bytes()},
+            {"paths", std::move(paths)}
+        });
+    }
+
+    return j.dump(4);
+}
+
+std::string JsonReportGenerator::generate_diff_report(const InventoryDiff& diff) const {
+    static constexpr std::array<const char*, kChangeKinds> kNames = {"appeared", "disappeared", "grew", "shrank"};
+    json j;
+    j["summary"] = {
+        {"old", {{"root", diff.old_root}, {"files", diff.old_files}, {"directories", diff.old_directories},
+                 {"size", diff.old_size}, {"allocated_size", diff.old_allocated_size}}},
+        {"new", {{"root", diff.new_root}, {"files", diff.new_files}, {"directories", diff.new_directories},
+                 {"size", diff.new_size}, {"allocated_size", diff.new_allocated_size}}},
+        {"files_modified", diff.files_modified}
+    };
+
+    auto changes = [&](const std::array<ChangeSet, kChangeKinds>& sets) {
+        json out;
+        for (size_t i = 0; i < kChangeKinds; ++i) {
+            json largest = json::array();
+            for (const auto& change : sets[i].largest) {
+                largest.push_back({{"path", change.path}, {"old_size", change.old_size}, {"new_size", change.new_size}});
+            }
+            out[kNames[i]] = {{"count", sets[i].count}, {"bytes", sets[i].bytes}, {"largest", std::move(largest)}};
+        }
+        return out;
+    };
+    j["files"] = changes(diff.files);
+    j["directories"] = changes(diff.directories);
+
+    j["extensions"] = json::array();
+    for (const auto& ext : diff.extensions) {
+        j["extensions"].push_back({
+            {"extension", ext.extension},
+            {"old_count", ext.old_count},
+            {"new_count", ext.new_count},
+            {"old_size", ext.old_size},
+            {"new_size", ext.new_size}
+        });
+    }
+
+    return j.dump(4);
+}
+
 } // namespace analyzer
@@ -0,0 +1,182 @@
+#include "ScanCache.hpp"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+namespace analyzer {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int kFormatVersion = 7;
+// Records are length-prefixed; a zero length ends the file, so a torn one
+// shows as a missing end rather than as a shorter cache.
+constexpr size_t kLengthBytes = 4;
+constexpr uint32_t kMaxRecordBytes = UINT32_MAX;
+
+void put_length(std::ostream& out, uint32_t length) {
+    char bytes[kLengthBytes];
+    for (size_t i = 0; i < kLengthBytes; ++i) bytes[i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+    out.write(bytes, kLengthBytes);
+}
+
+bool get_length(std::istream& in, uint32_t& length) {
+    unsigned char bytes[kLengthBytes];
+    if (!in.read(reinterpret_cast<char*>(bytes), kLengthBytes)) return false;
+    length = 0;
+    for (size_t i = 0; i < kLengthBytes; ++i) length |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+    return true;
+}
+
+// One msgpack document, reading into `bytes`, which is reused.
+bool get_document(std::istream& in, std::vector<uint8_t>& bytes, json& j) {
+    uint32_t length = 0;
+    if (!get_length(in, length) || length == 0) return false;
+    bytes.resize(length);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), length)) return false;
+    j = json::from_msgpack(bytes);
+    return true;
+}
+
+bool put_document(std::ostream& out, const json& j) {
+    const std::vector<uint8_t> bytes = json::to_msgpack(j);
+    if (bytes.size() > kMaxRecordBytes) return false;
+    put_length(out, static_cast<uint32_t>(bytes.size()));
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out);
+}
+
+json to_json(const CachedDirectory& record) {
+    json extensions = json::array();
+    for (const auto& ext : record.extensions) extensions.push_back({ext.extension, ext.count, ext.size, ext.histogram, ext.smallest, ext.largest});
+    json files = json::array();
+    for (const auto& file : record.top_files) files.push_back({file.name, file.size, file.allocated_size, file.mtime, file.atime, file.ctime});
+    json stated = json::array();
+    for (const auto& file : record.files) stated.push_back({file.name, file.inode, file.size, file.mtime, file.ctime});
+    return {
+        {"mtime", record.mtime},
+        {"totals", {record.total_files, record.total_directories, record.total_size, record.total_allocated_size}},
+        {"ext", std::move(extensions)},
+        {"hist", record.size_histogram},
+        {"age", record.age_distribution},
+        {"users", record.users},
+        {"groups", record.groups},
+        {"files", std::move(files)},
+        {"subdirs", record.subdirs},
+        {"recent", record.recent_mtimes},
+        {"stated", std::move(stated)}
+    };
+}
+
+CachedDirectory from_json(const json& j) {
+    CachedDirectory record;
+    record.mtime = j.at("mtime").get<int64_t>();
+    const auto& totals = j.at("totals");
+    record.total_files = totals.at(0).get<uint64_t>();
+    record.total_directories = totals.at(1).get<uint64_t>();
+    record.total_size = totals.at(2).get<uint64_t>();
+    record.total_allocated_size = totals.at(3).get<uint64_t>();
+    for (const auto& ext : j.at("ext")) {
+        record.extensions.push_back({ext.at(0).get<std::string>(), ext.at(1).get<uint64_t>(), ext.at(2).get<uint64_t>(),
+                                     ext.at(3).get<std::vector<uint64_t>>(), ext.at(4).get<uint64_t>(),
+                                     ext.at(5).get<uint64_t>()});
+    }
+    record.size_histogram = j.at("hist").get<std::vector<uint64_t>>();
+    record.age_distribution = j.at("age").get<std::vector<uint64_t>>();
+    record.users = j.at("users").get<std::vector<uint64_t>>();
+    record.groups = j.at("groups").get<std::vector<uint64_t>>();
+    for (const auto& file : j.at("files")) {
+        record.top_files.push_back({file.at(0).get<std::string>(), file.at(1).get<uint64_t>(), file.at(2).get<uint64_t>(),
+                                    file.at(3).get<int64_t>(), file.at(4).get<int64_t>(), file.at(5).get<int64_t>()});
+    }
+    record.subdirs = j.at("subdirs").get<std::vector<std::string>>();
+    record.recent_mtimes = j.at("recent").get<std::vector<int64_t>>();
+    for (const auto& file : j.at("stated")) {
+        record.files.push_back({file.at(0).get<std::string>(), file.at(1).get<uint64_t>(), file.at(2).get<uint64_t>(),
+                                file.at(3).get<int64_t>(), file.at(4).get<int64_t>()});
+    }
+    return record;
+}
+
+} // namespace
+
+ScanCache::ScanCache(std::string fingerprint) : fingerprint_(std::move(fingerprint)) {}
+
+void ScanCache::load(const fs::path& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) return;
+
+    try {
+        std::vector<uint8_t> bytes;
+        json j;
+        if (!get_document(in, bytes, j) || j.value("version", 0) != kFormatVersion ||
+            j.value("fingerprint", "") != fingerprint_) {
+            return;
+        }
+        uint32_t length = 0;
+        while (get_length(in, length) && length != 0) {
+            bytes.resize(length);
+            if (!in.read(reinterpret_cast<char*>(bytes.data()), length)) break;
+            j = json::from_msgpack(bytes);
+            directories_.emplace(Key{j.at("dev").get<uint64_t>(), j.at("ino").get<uint64_t>()}, from_json(j.at("record")));
+        }
+        if (!in || length != 0) {
+            std::cerr << "Warning: Ignoring truncated scan cache " << file << std::endl;
+            directories_.clear();
+        }
+    } catch (const json::exception& e) {
+        std::cerr << "Warning: Ignoring unreadable scan cache " << file << ": " << e.what() << std::endl;
+        directories_.clear();
+    }
+}
+
+bool ScanCache::save(const fs::path& file, bool keep_unseen) const {
+    std::lock_guard lock(mutex_);
+
+    // Write next to the target and rename so a crash never leaves a torn cache.
+    fs::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        if (!put_document(out, {{"version", kFormatVersion}, {"fingerprint", fingerprint_}})) return false;
+        for (const auto& [key, record] : directories_) {
+            // Records not visited this time belong to deleted or unreachable directories.
+            if (!record.seen && !keep_unseen) continue;
+            if (!put_document(out, {{"dev", key.device}, {"ino", key.inode}, {"record", to_json(record)}})) return false;
+        }
+        put_length(out, 0);
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(temp, file, ec);
+    return !ec;
+}
+
+const CachedDirectory* ScanCache::lookup(uint64_t device, uint64_t inode, int64_t mtime) {
+    std::lock_guard lock(mutex_);
+    auto it = directories_.find(Key{device, inode});
+    if (it == directories_.end() || it->second.mtime != mtime) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    it->second.seen = true;
+    return &it->second;
+}
+
+void ScanCache::reject() {
+    std::lock_guard lock(mutex_);
+    hits_--;
+    misses_++;
+}
+
+void ScanCache::store(uint64_t device, uint64_t inode, CachedDirectory record) {
+    record.seen = true;
+    std::lock_guard lock(mutex_);
+    directories_.insert_or_assign(Key{device, inode}, std::move(record));
+}
+
+} // namespace analyzer
@@ -0,0 +1,221 @@
+#include "ScanProgress.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace analyzer {
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int kHistoryVersion = 1;
+// ETAs only mean something once a fair part of the last run's work is done.
+constexpr double kMinEtaFraction = 0.01;
+
+std::atomic<uint64_t> next_progress_id{1};
+
+fs::path history_file() {
+    if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache && *cache) {
+        return fs::path(cache) / "file-stat-analyzer" / "scans.json";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return fs::path(home) / ".cache" / "file-stat-analyzer" / "scans.json";
+    }
+    return {};
+}
+
+json load_history(const fs::path& file) {
+    std::ifstream in(file);
+    if (!in.is_open()) return json::object();
+    try {
+        json j = json::parse(in);
+        if (j.value("version", 0) == kHistoryVersion && j.contains("scans")) return j;
+    } catch (const json::exception&) {
+        // A damaged history only costs the next ETA.
+    }
+    return json::object();
+}
+
+std::string format_count(uint64_t count) {
+    std::ostringstream oss;
+    if (count >= 1000000) {
+        oss << std::fixed << std::setprecision(1) << static_cast<double>(count) / 1e6 << "M";
+    } else if (count >= 10000) {
+        oss << std::fixed << std::setprecision(1) << static_cast<double>(count) / 1e3 << "K";
+    } else {
+        oss << count;
+    }
+    return oss.str();
+}
+
+std::string format_size(uint64_t bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
+    int i = 0;
+    double size = static_cast<double>(bytes);
+    while (size >= 1024 && i < 5) {
+        size /= 1024;
+        i++;
+    }
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << size << " " << units[i];
+    return oss.str();
+}
+
+std::string format_duration(double seconds) {
+    const auto total = static_cast<uint64_t>(std::max(0.0, seconds));
+    std::ostringstream oss;
+    oss << total / 3600 << ":" << std::setfill('0') << std::setw(2) << total / 60 % 60 << ":" << std::setw(2) << total % 60;
+    return oss.str();
+}
+
+} // namespace
+
+ScanProgress::ScanProgress() : id_(next_progress_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+ScanProgress::Counters& ScanProgress::local() {
+    // Ids rather than addresses: a new instance may reuse an old one's.
+    thread_local uint64_t owner = 0;
+    thread_local Counters* counters = nullptr;
+    if (owner != id_) {
+        counters = &add_thread();
+        owner = id_;
+    }
+    return *counters;
+}
+
+ScanProgress::Counters& ScanProgress::add_thread() {
+    std::lock_guard lock(mutex_);
+    threads_.push_back(std::make_unique<Counters>());
+    return *threads_.back();
+}
+
+ScanProgress::Snapshot ScanProgress::total() const {
+    Snapshot total;
+    std::lock_guard lock(mutex_);
+    for (const auto& counters : threads_) {
+        total.directories += counters->directories.load(std::memory_order_relaxed);
+        total.files += counters->files.load(std::memory_order_relaxed);
+        total.size += counters->size.load(std::memory_order_relaxed);
+        total.errors += counters->errors.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::optional<ScanRecord> load_scan_record(const std::string& key) {
+    const fs::path file = history_file();
+    if (file.empty()) return std::nullopt;
+    const json history = load_history(file);
+    if (!history.contains("scans") || !history["scans"].contains(key)) return std::nullopt;
+    try {
+        const auto& scan = history["scans"][key];
+        return ScanRecord{scan.at("directories").get<uint64_t>(), scan.at("files").get<uint64_t>(),
+                          scan.at("size").get<uint64_t>(), scan.at("seconds").get<double>()};
+    } catch (const json::exception&) {
+        return std::nullopt;
+    }
+}
+
+void save_scan_record(const std::string& key, const ScanRecord& record) {
+    const fs::path file = history_file();
+    if (file.empty()) return;
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+
+    json history = load_history(file);
+    history["version"] = kHistoryVersion;
+    history["scans"][key] = {
+        {"directories", record.directories},
+        {"files", record.files},
+        {"size", record.size},
+        {"seconds", record.seconds}
+    };
+
+    // Same write-and-rename as the scan cache: concurrent runs never see half a file.
+    fs::path temp = file;
+    temp += ".tmp" + std::to_string(::getpid());
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out.is_open()) return;
+        out << history.dump();
+        if (!out) return;
+    }
+    fs::rename(temp, file, ec);
+}
+
+ProgressReporter::ProgressReporter(const ScanProgress& progress, std::chrono::seconds interval,
+                                   std::optional<ScanRecord> previous)
+    : progress_(progress), interval_(std::max(interval, std::chrono::seconds(1))), previous_(previous) {
+#if defined(__unix__) || defined(__APPLE__)
+    terminal_ = ::isatty(STDERR_FILENO) == 1;
+#endif
+    thread_ = std::thread([this] { run(); });
+}
+
+ProgressReporter::~ProgressReporter() { stop(); }
+
+void ProgressReporter::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    if (terminal_) std::cerr << "\r\033[K" << std::flush;
+}
+
+void ProgressReporter::run() {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto last_time = start;
+    ScanProgress::Snapshot last;
+
+    std::unique_lock lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this] { return stopping_; })) {
+        const auto now = Clock::now();
+        const ScanProgress::Snapshot current = progress_.total();
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        const double interval = std::chrono::duration<double>(now - last_time).count();
+        std::cerr << (terminal_ ? "\r" : "") << line(current, last, elapsed, interval) << (terminal_ ? "\033[K" : "\n")
+                  << std::flush;
+        last = current;
+        last_time = now;
+    }
+}
+
+std::string ProgressReporter::line(const ScanProgress::Snapshot& now, const ScanProgress::Snapshot& last,
+                                   double elapsed, double interval) const {
+    std::ostringstream oss;
+    oss << "Progress: " << format_count(now.directories) << " dirs, " << format_count(now.files) << " files, "
+        << format_size(now.size) << " | "
+        << format_count(static_cast<uint64_t>(static_cast<double>(now.directories - last.directories) / interval))
+        << " dirs/s";
+    if (now.errors > 0) oss << " | " << now.errors << " errors";
+    oss << " | " << format_duration(elapsed);
+
+    // Directories are the unit of work, so the share of last run's
+    // directories done so far, at the pace of this run, gives the rest.
+    if (previous_ && previous_->directories > 0) {
+        const double done = static_cast<double>(now.directories) / static_cast<double>(previous_->directories);
+        if (done >= 1) {
+            oss << " | past last run's " << format_count(previous_->directories) << " dirs";
+        } else if (done >= kMinEtaFraction) {
+            oss << " | " << static_cast<int>(done * 100) << "%, ETA " << format_duration(elapsed * (1 - done) / done);
+        }
+    }
+    return oss.str();
+}
+
+} // namespace analyzer
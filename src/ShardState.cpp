@@ -0,0 +1,296 @@
+#include "ShardState.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace analyzer {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int kFormatVersion = 7;
+
+json ranges_to_json(const std::vector<DirectoryStats::Range>& ranges) {
+    json array = json::array();
+    for (const auto& range : ranges) array.push_back({range.label, range.count});
+    return array;
+}
+
+std::vector<DirectoryStats::Range> ranges_from_json(const json& j) {
+    std::vector<DirectoryStats::Range> ranges;
+    for (const auto& range : j) ranges.push_back({range.at(0).get<std::string>(), range.at(1).get<uint64_t>()});
+    return ranges;
+}
+
+json errors_to_json(const ErrorSummary& errors) {
+    json by_code = json::array();
+    for (const auto& [code, count] : errors.by_code) by_code.push_back({code, count});
+    json samples = json::array();
+    for (const auto& sample : errors.samples) {
+        samples.push_back({sample.path, static_cast<int>(sample.operation), sample.code});
+    }
+    json worst = json::array();
+    for (const auto& dir : errors.worst_directories) worst.push_back({dir.path, dir.errors});
+    return {{"total", errors.total}, {"directories", errors.directories}, {"by_code", std::move(by_code)},
+            {"samples", std::move(samples)}, {"worst", std::move(worst)}};
+}
+
+void errors_from_json(const json& j, ErrorSummary& errors) {
+    errors.total = j.at("total").get<uint64_t>();
+    errors.directories = j.at("directories").get<uint64_t>();
+    for (const auto& entry : j.at("by_code")) errors.by_code[entry.at(0).get<int>()] = entry.at(1).get<uint64_t>();
+    for (const auto& sample : j.at("samples")) {
+        errors.samples.push_back({sample.at(0).get<std::string>(), static_cast<ErrorOperation>(sample.at(1).get<int>()),
+                                  sample.at(2).get<int>()});
+    }
+    for (const auto& dir : j.at("worst")) {
+        errors.worst_directories.push_back({dir.at(0).get<std::string>(), dir.at(1).get<uint64_t>()});
+    }
+}
+
+json directories_to_json(const std::vector<DirectorySummary>& list) {
+    json array = json::array();
+    for (const auto& dir : list) array.push_back({dir.path.string(), dir.files, dir.size, dir.allocated_size});
+    return array;
+}
+
+std::vector<DirectorySummary> directories_from_json(const json& j) {
+    std::vector<DirectorySummary> list;
+    for (const auto& dir : j) {
+        list.push_back({dir.at(0).get<std::string>(), dir.at(1).get<uint64_t>(), dir.at(2).get<uint64_t>(),
+                        dir.at(3).get<uint64_t>()});
+    }
+    return list;
+}
+
+json owners_to_json(const OwnerTable& table) {
+    json array = json::array();
+    table.for_each([&](uint32_t id, const OwnerTable::Usage& usage) {
+        array.push_back({id, usage.files, usage.size, usage.allocated_size});
+    });
+    return array;
+}
+
+void owners_from_json(const json& j, OwnerTable& table) {
+    for (const auto& owner : j) {
+        table.add_totals(owner.at(0).get<uint32_t>(),
+                         {owner.at(1).get<uint64_t>(), owner.at(2).get<uint64_t>(), owner.at(3).get<uint64_t>()});
+    }
+}
+
+json stats_to_json(const DirectoryStats& stats) {
+    json extensions = json::array();
+    for (uint32_t id = 0; id < stats.extensions.size(); ++id) {
+        const auto& totals = stats.extensions.totals(id);
+        const auto& histogram = stats.extensions.histogram(id);
+        json buckets = json::array();
+        for (size_t bucket = 0; bucket < histogram.bucket_count(); ++bucket) {
+            if (histogram.bucket(bucket) == 0) continue;
+            buckets.push_back(bucket);
+            buckets.push_back(histogram.bucket(bucket));
+        }
+        extensions.push_back({stats.extensions.name(id), totals.count, totals.size, histogram.precision(), std::move(buckets),
+                              histogram.smallest(), histogram.largest()});
+    }
+
+    json files = json::array();
+    stats.top_files.for_each_file([&](std::string_view path, const RankedAttributes& attributes) {
+        files.push_back({path, attributes.size, attributes.allocated_size, attributes.last_modified.time_since_epoch().count(),
+                         attributes.last_accessed.time_since_epoch().count(),
+                         attributes.last_changed.time_since_epoch().count()});
+    });
+
+    json mounts = json::array();
+    for (const auto& mount : stats.mounts) {
+        mounts.push_back({mount.mount_point.string(), mount.fs_type, mount.source, mount.directories, mount.files,
+                          mount.size, mount.allocated_size});
+    }
+
+    return {
+        {"totals", {stats.total_files, stats.total_directories, stats.total_size, stats.total_allocated_size,
+                    stats.hard_links_skipped, stats.directories_revisited}},
+        {"every_link", stats.counts_every_link},
+        {"errors", errors_to_json(stats.errors)},
+        {"unvisited", {{"partial", stats.partial}, {"count", stats.directories_unvisited},
+                       {"listed", stats.unvisited_directories}}},
+        {"ext", std::move(extensions)},
+        {"sizes", ranges_to_json(stats.size_histogram)},
+        {"ages", ranges_to_json(stats.age_distribution)},
+        {"users", owners_to_json(stats.user_usage)},
+        {"groups", owners_to_json(stats.group_usage)},
+        {"top", {{"capacity", stats.top_files.capacity()}, {"rankings", stats.top_files.rankings()}, {"files", std::move(files)}}},
+        {"largest_dirs", directories_to_json(stats.largest_directories)},
+        {"populated_dirs", directories_to_json(stats.most_populated_directories)},
+        {"mounts", std::move(mounts)}
+    };
+}
+
+DirectoryStats stats_from_json(const json& j) {
+    DirectoryStats stats;
+    const auto& totals = j.at("totals");
+    stats.total_files = totals.at(0).get<uint64_t>();
+    stats.total_directories = totals.at(1).get<uint64_t>();
+    stats.total_size = totals.at(2).get<uint64_t>();
+    stats.total_allocated_size = totals.at(3).get<uint64_t>();
+    stats.hard_links_skipped = totals.at(4).get<uint64_t>();
+    stats.directories_revisited = totals.at(5).get<uint64_t>();
+    stats.counts_every_link = j.at("every_link").get<bool>();
+    errors_from_json(j.at("errors"), stats.errors);
+    const auto& unvisited = j.at("unvisited");
+    stats.partial = unvisited.at("partial").get<bool>();
+    stats.directories_unvisited = unvisited.at("count").get<uint64_t>();
+    stats.unvisited_directories = unvisited.at("listed").get<std::vector<std::string>>();
+
+    for (const auto& ext : j.at("ext")) {
+        if (stats.extensions.size() == 0) stats.extensions = ExtensionTable(ext.at(3).get<unsigned>());
+        const uint32_t id = stats.extensions.intern(ext.at(0).get<std::string>());
+        stats.extensions.add_totals(id, ext.at(1).get<uint64_t>(), ext.at(2).get<uint64_t>());
+        const auto& buckets = ext.at(4);
+        for (size_t i = 0; i + 1 < buckets.size(); i += 2) {
+            stats.extensions.histogram(id).add_bucket(buckets.at(i).get<size_t>(), buckets.at(i + 1).get<uint64_t>());
+        }
+        stats.extensions.histogram(id).restore(ext.at(5).get<uint64_t>(), ext.at(6).get<uint64_t>());
+    }
+
+    stats.size_histogram = ranges_from_json(j.at("sizes"));
+    stats.age_distribution = ranges_from_json(j.at("ages"));
+    owners_from_json(j.at("users"), stats.user_usage);
+    owners_from_json(j.at("groups"), stats.group_usage);
+
+    const auto& top = j.at("top");
+    stats.top_files = TopFiles(top.at("capacity").get<size_t>(), top.at("rankings").get<unsigned>());
+    auto to_time = [](const json& ticks) { return fs::file_time_type(fs::file_time_type::duration(ticks.get<int64_t>())); };
+    for (const auto& file : top.at("files")) {
+        RankedAttributes attributes;
+        attributes.size = file.at(1).get<uint64_t>();
+        attributes.allocated_size = file.at(2).get<uint64_t>();
+        attributes.last_modified = to_time(file.at(3));
+        attributes.last_accessed = to_time(file.at(4));
+        attributes.last_changed = to_time(file.at(5));
+        stats.top_files.offer(file.at(0).get<std::string>(), attributes);
+    }
+
+    stats.largest_directories = directories_from_json(j.at("largest_dirs"));
+    stats.most_populated_directories = directories_from_json(j.at("populated_dirs"));
+    for (const auto& mount : j.at("mounts")) {
+        stats.mounts.push_back({mount.at(0).get<std::string>(), mount.at(1).get<std::string>(), mount.at(2).get<std::string>(),
+                                mount.at(3).get<uint64_t>(), mount.at(4).get<uint64_t>(), mount.at(5).get<uint64_t>(),
+                                mount.at(6).get<uint64_t>()});
+    }
+    return stats;
+}
+
+// Every shard ranks the subtrees it scanned, and subtrees never span
+// shards, so the overall top n is the top n of the union.
+void rerank(std::vector<DirectorySummary>& list, size_t n, uint64_t DirectorySummary::*key) {
+    std::sort(list.begin(), list.end(), [key](const DirectorySummary& a, const DirectorySummary& b) {
+        if (a.*key != b.*key) return a.*key > b.*key;
+        return a.path < b.path;
+    });
+    if (list.size() > n) list.resize(n);
+}
+
+} // namespace
+
+bool save_shard_state(const fs::path& file, const ShardState& state) {
+    json j = {
+        {"version", kFormatVersion},
+        {"target", state.target},
+        {"shard", {state.shard_index, state.shard_count}},
+        {"settings", state.settings},
+        {"stats", stats_to_json(state.stats)}
+    };
+
+    // Same write-and-rename as the scan cache: a reader never sees half a file.
+    fs::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        auto bytes = json::to_msgpack(j);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(temp, file, ec);
+    return !ec;
+}
+
+bool load_shard_state(const fs::path& file, ShardState& state) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Warning: Could not open shard state " << file << std::endl;
+        return false;
+    }
+    try {
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        json j = json::from_msgpack(bytes);
+        if (j.value("version", 0) != kFormatVersion) {
+            std::cerr << "Warning: " << file << " is not a shard state of this version" << std::endl;
+            return false;
+        }
+        state.target = j.at("target").get<std::string>();
+        state.shard_index = j.at("shard").at(0).get<unsigned>();
+        state.shard_count = j.at("shard").at(1).get<unsigned>();
+        if (state.shard_count == 0 || state.shard_index >= state.shard_count) {
+            std::cerr << "Warning: " << file << " names shard " << state.shard_index << "/" << state.shard_count
+                      << ", which does not exist" << std::endl;
+            return false;
+        }
+        state.settings = j.at("settings").get<std::string>();
+        state.stats = stats_from_json(j.at("stats"));
+    } catch (const json::exception& e) {
+        std::cerr << "Warning: Could not read shard state " << file << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+DirectoryStats merge_shard_states(const std::vector<ShardState>& states) {
+    DirectoryStats merged;
+    if (states.empty()) return merged;
+
+    const ShardState& first = states.front();
+    std::vector<bool> present(first.shard_count, false);
+    merged = first.stats;
+    present[first.shard_index] = true;
+
+    for (size_t i = 1; i < states.size(); ++i) {
+        const ShardState& state = states[i];
+        if (state.target != first.target || state.shard_count != first.shard_count || state.settings != first.settings) {
+            std::cerr << "Warning: Skipping shard " << state.shard_index << "/" << state.shard_count << " of " << state.target
+                      << ": not part of the same scan as the first state" << std::endl;
+            continue;
+        }
+        if (present[state.shard_index]) {
+            std::cerr << "Warning: Skipping repeated shard " << state.shard_index << "/" << state.shard_count << std::endl;
+            continue;
+        }
+        present[state.shard_index] = true;
+
+        merged.merge(state.stats);
+        merged.largest_directories.insert(merged.largest_directories.end(), state.stats.largest_directories.begin(),
+                                          state.stats.largest_directories.end());
+        merged.most_populated_directories.insert(merged.most_populated_directories.end(),
+                                                 state.stats.most_populated_directories.begin(),
+                                                 state.stats.most_populated_directories.end());
+    }
+
+    for (unsigned shard = 0; shard < present.size(); ++shard) {
+        if (!present[shard]) {
+            std::cerr << "Warning: Shard " << shard << "/" << first.shard_count << " is missing; the report is partial" << std::endl;
+            merged.partial = true;
+        }
+    }
+
+    const size_t n = merged.top_files.capacity();
+    rerank(merged.largest_directories, n, &DirectorySummary::size);
+    rerank(merged.most_populated_directories, n, &DirectorySummary::files);
+    merged.finalize();
+    return merged;
+}
+
+} // namespace analyzer
@@ -0,0 +1,106 @@
+#include "SizeHistogram.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace analyzer {
+
+SizeHistogram::SizeHistogram(unsigned precision) : precision_(std::min(precision, kMaxPrecision)) {}
+
+size_t SizeHistogram::bucket_of(uint64_t size) const {
+    // Below 2^precision every value has its own bucket. Above, the top
+    // precision+1 bits select the bucket: the position of the highest set
+    // bit picks the power of two, the bits after it the sub-bucket.
+    const auto width = static_cast<unsigned>(std::bit_width(size));
+    if (width <= precision_) return static_cast<size_t>(size);
+    const unsigned shift = width - 1 - precision_;
+    const uint64_t sub_bucket = (size >> shift) & ((uint64_t{1} << precision_) - 1);
+    return (static_cast<size_t>(shift + 1) << precision_) + static_cast<size_t>(sub_bucket);
+}
+
+uint64_t SizeHistogram::lowest_in_bucket(size_t index) const {
+    const size_t magnitude = index >> precision_;
+    if (magnitude == 0) return index;
+    const uint64_t sub_bucket = index & ((size_t{1} << precision_) - 1);
+    return ((uint64_t{1} << precision_) | sub_bucket) << (magnitude - 1);
+}
+
+uint64_t SizeHistogram::highest_in_bucket(size_t index) const {
+    const size_t magnitude = index >> precision_;
+    if (magnitude == 0) return index;
+    return lowest_in_bucket(index) + ((uint64_t{1} << (magnitude - 1)) - 1);
+}
+
+void SizeHistogram::count(size_t index, uint64_t count) {
+    if (index >= counts_.size()) counts_.resize(index + 1, 0);
+    counts_[index] += count;
+    total_ += count;
+}
+
+void SizeHistogram::add_bucket(size_t index, uint64_t count) {
+    if (count == 0) return;
+    this->count(index, count);
+    smallest_ = std::min(smallest_, lowest_in_bucket(index));
+    largest_ = std::max(largest_, highest_in_bucket(index));
+}
+
+void SizeHistogram::restore(uint64_t smallest, uint64_t largest) {
+    // Saved bounds that do not fit the buckets are ignored, not trusted.
+    const uint64_t low = std::max(smallest_, smallest);
+    const uint64_t high = std::min(largest_, largest);
+    if (total_ == 0 || low > high) return;
+    smallest_ = low;
+    largest_ = high;
+}
+
+void SizeHistogram::remove(uint64_t size) {
+    const size_t index = bucket_of(size);
+    if (index >= counts_.size() || counts_[index] == 0) return;
+    counts_[index]--;
+    if (--total_ == 0) {
+        smallest_ = std::numeric_limits<uint64_t>::max();
+        largest_ = 0;
+    }
+}
+
+void SizeHistogram::scale(double weight) {
+    total_ = 0;
+    for (auto& count : counts_) {
+        count = static_cast<uint64_t>(std::llround(static_cast<double>(count) * weight));
+        total_ += count;
+    }
+}
+
+void SizeHistogram::merge(const SizeHistogram& other) {
+    // An unused histogram takes on the layout of the first one merged in.
+    if (total_ == 0 && counts_.empty()) precision_ = other.precision_;
+    smallest_ = std::min(smallest_, other.smallest_);
+    largest_ = std::max(largest_, other.largest_);
+    if (other.precision_ != precision_) {
+        for (size_t i = 0; i < other.counts_.size(); ++i) {
+            if (other.counts_[i] > 0) count(bucket_of(other.lowest_in_bucket(i)), other.counts_[i]);
+        }
+        return;
+    }
+    if (other.counts_.size() > counts_.size()) counts_.resize(other.counts_.size(), 0);
+    for (size_t i = 0; i < other.counts_.size(); ++i) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+}
+
+uint64_t SizeHistogram::percentile(double percent) const {
+    if (total_ == 0) return 0;
+    const double clamped = std::clamp(percent, 0.0, 100.0);
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(total_))));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            const uint64_t low = lowest_in_bucket(i);
+            return std::clamp(low + (highest_in_bucket(i) - low) / 2, smallest_, largest_);
+        }
+    }
+    return largest_;
+}
+
+} // namespace analyzer
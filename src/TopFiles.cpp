@@ -0,0 +1,134 @@
+#include "TopFiles.hpp"
+#include "FileSystemAnalyzer.hpp"
+#include <algorithm>
+
+namespace analyzer {
+
+namespace {
+
+// Arenas smaller than this are never worth compacting.
+constexpr size_t kCompactThreshold = 64 * 1024;
+
+} // namespace
+
+TopFiles::TopFiles(size_t capacity, unsigned rankings) : capacity_(capacity), rankings_(rankings) {}
+
+int64_t TopFiles::score(Ranking ranking, const RankedAttributes& attributes) {
+    // ~x reverses the order without the overflow of -x.
+    switch (ranking) {
+        case Ranking::Largest: return static_cast<int64_t>(attributes.size);
+        case Ranking::Oldest: return ~attributes.last_modified.time_since_epoch().count();
+        case Ranking::Newest: return attributes.last_modified.time_since_epoch().count();
+        case Ranking::LeastAccessed: return ~attributes.last_accessed.time_since_epoch().count();
+        case Ranking::RecentlyChanged: return attributes.last_changed.time_since_epoch().count();
+    }
+    return 0;
+}
+
+void TopFiles::offer(std::string_view path, const RankedAttributes& attributes) {
+    for (size_t i = 0; i < kRankingCount; ++i) {
+        auto ranking = static_cast<Ranking>(i);
+        if (tracks(ranking)) offer(lists_[i], score(ranking, attributes), path, attributes);
+    }
+}
+
+void TopFiles::offer(List& list, int64_t score, std::string_view path, const RankedAttributes& attributes) {
+    if (capacity_ == 0) return;
+    auto worse_on_top = [&list](const Record& a, const Record& b) {
+        return better(a.score, list.path(a), b.score, list.path(b));
+    };
+
+    if (list.heap.size() >= capacity_) {
+        // The common case: not better than the current worst, nothing to do.
+        const Record& worst = list.heap.front();
+        if (!better(score, path, worst.score, list.path(worst))) return;
+        std::pop_heap(list.heap.begin(), list.heap.end(), worse_on_top);
+        list.heap.pop_back();
+    }
+
+    Record record;
+    record.score = score;
+    record.path_offset = list.arena.size();
+    record.path_length = static_cast<uint32_t>(path.size());
+    record.attributes = attributes;
+    list.arena.append(path);
+    list.heap.push_back(record);
+    std::push_heap(list.heap.begin(), list.heap.end(), worse_on_top);
+
+    if (list.arena.size() > kCompactThreshold) compact(list);
+}
+
+void TopFiles::compact(List& list) {
+    size_t live = 0;
+    for (const auto& record : list.heap) live += record.path_length;
+    if (list.arena.size() < 4 * live) return;
+
+    std::string arena;
+    arena.reserve(2 * live);
+    for (auto& record : list.heap) {
+        auto path = list.path(record);
+        record.path_offset = arena.size();
+        arena.append(path);
+    }
+    list.arena.swap(arena);
+}
+
+bool TopFiles::remove(std::string_view path) {
+    bool removed = false;
+    for (auto& list : lists_) {
+        auto it = std::find_if(list.heap.begin(), list.heap.end(),
+                               [&](const Record& record) { return list.path(record) == path; });
+        if (it == list.heap.end()) continue;
+        list.heap.erase(it);
+        std::make_heap(list.heap.begin(), list.heap.end(), [&list](const Record& a, const Record& b) {
+            return better(a.score, list.path(a), b.score, list.path(b));
+        });
+        removed = true;
+    }
+    return removed;
+}
+
+void TopFiles::merge(const TopFiles& other) {
+    if (capacity_ == 0 && rankings_ == 0) {
+        capacity_ = other.capacity_;
+        rankings_ = other.rankings_;
+    }
+    for (size_t i = 0; i < kRankingCount; ++i) {
+        if (!tracks(static_cast<Ranking>(i))) continue;
+        const List& from = other.lists_[i];
+        for (const auto& record : from.heap) offer(lists_[i], record.score, from.path(record), record.attributes);
+    }
+}
+
+void TopFiles::clear() {
+    for (auto& list : lists_) {
+        list.heap.clear();
+        list.arena.clear();
+    }
+}
+
+std::vector<FileEntry> TopFiles::entries(Ranking ranking) const {
+    const List& list = lists_[static_cast<size_t>(ranking)];
+    std::vector<const Record*> records;
+    for (const auto& record : list.heap) records.push_back(&record);
+    std::sort(records.begin(), records.end(), [&list](const Record* a, const Record* b) {
+        return better(a->score, list.path(*a), b->score, list.path(*b));
+    });
+
+    std::vector<FileEntry> result;
+    result.reserve(records.size());
+    for (const Record* record : records) {
+        FileEntry entry;
+        entry.path = fs::path(std::string(list.path(*record)));
+        entry.size = record->attributes.size;
+        entry.allocated_size = record->attributes.allocated_size;
+        entry.extension = extension_of(entry.path);
+        entry.last_modified = record->attributes.last_modified;
+        entry.last_accessed = record->attributes.last_accessed;
+        entry.last_changed = record->attributes.last_changed;
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+} // namespace analyzer
@@ -0,0 +1,208 @@
+#include "UringStatEngine.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(STATX_TYPE) && defined(__NR_io_uring_setup)
+#define ANALYZER_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace analyzer {
+
+#ifdef ANALYZER_HAVE_IO_URING
+
+struct UringStatEngine::Ring {
+    void* sq_map = MAP_FAILED;
+    size_t sq_map_size = 0;
+    void* cq_map = MAP_FAILED;
+    size_t cq_map_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // One statx buffer per in-flight request; user_data carries the slot.
+    std::vector<struct statx> buffers;
+    std::vector<size_t> slot_owner;
+    std::vector<unsigned> free_slots;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size);
+        if (cq_map != MAP_FAILED && cq_map != sq_map) ::munmap(cq_map, cq_map_size);
+        if (sq_map != MAP_FAILED) ::munmap(sq_map, sq_map_size);
+    }
+};
+
+namespace {
+
+template <typename T>
+T* ring_field(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+unsigned load_acquire(unsigned* p) { return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire); }
+void store_release(unsigned* p, unsigned v) { std::atomic_ref<unsigned>(*p).store(v, std::memory_order_release); }
+
+} // namespace
+
+UringStatEngine::UringStatEngine(unsigned queue_depth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, queue_depth, &params));
+    if (fd < 0) return; // ENOSYS, EPERM under seccomp, ... -> sync fallback
+
+    auto ring = std::make_unique<Ring>();
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) ring->sq_map_size = ring->cq_map_size = std::max(ring->sq_map_size, ring->cq_map_size);
+
+    ring->sq_map = ::mmap(nullptr, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) { ::close(fd); return; }
+    ring->cq_map = single_mmap ? ring->sq_map
+        : ::mmap(nullptr, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED) { ::close(fd); return; }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) { ::close(fd); return; }
+
+    ring->sq_tail = ring_field<unsigned>(ring->sq_map, params.sq_off.tail);
+    ring->sq_mask = ring_field<unsigned>(ring->sq_map, params.sq_off.ring_mask);
+    ring->sq_array = ring_field<unsigned>(ring->sq_map, params.sq_off.array);
+    ring->cq_head = ring_field<unsigned>(ring->cq_map, params.cq_off.head);
+    ring->cq_tail = ring_field<unsigned>(ring->cq_map, params.cq_off.tail);
+    ring->cq_mask = ring_field<unsigned>(ring->cq_map, params.cq_off.ring_mask);
+    ring->cqes = ring_field<io_uring_cqe>(ring->cq_map, params.cq_off.cqes);
+
+    // Never queue more than the SQ can hold; the CQ is at least twice as big.
+    unsigned slots = params.sq_entries;
+    ring->buffers.resize(slots);
+    ring->slot_owner.resize(slots);
+    for (unsigned slot = slots; slot > 0; --slot) ring->free_slots.push_back(slot - 1);
+
+    ring_ = std::move(ring);
+    ring_fd_ = fd;
+}
+
+UringStatEngine::~UringStatEngine() {
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+}
+
+void UringStatEngine::stat_batch(int dir_fd, const std::vector<const char*>& names, unsigned fields, const Completion& on_complete) {
+    if (!available()) {
+        for (size_t i = 0; i < names.size(); ++i) stat_sync(dir_fd, names[i], i, fields, on_complete);
+        return;
+    }
+
+    Ring& ring = *ring_;
+    const unsigned mask = statx_mask(fields);
+    std::vector<char> done(names.size(), 0);
+    size_t next = 0;
+    unsigned in_flight = 0;
+    unsigned unsubmitted = 0;
+
+    while (next < names.size() || in_flight > 0) {
+        unsigned tail = *ring.sq_tail;
+        while (next < names.size() && !ring.free_slots.empty()) {
+            unsigned slot = ring.free_slots.back();
+            ring.free_slots.pop_back();
+            ring.slot_owner[slot] = next;
+
+            unsigned index = tail & *ring.sq_mask;
+            io_uring_sqe& sqe = ring.sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_STATX;
+            sqe.fd = dir_fd;
+            sqe.addr = reinterpret_cast<uint64_t>(names[next]);
+            sqe.len = mask;
+            sqe.off = reinterpret_cast<uint64_t>(&ring.buffers[slot]);
+            sqe.statx_flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+            sqe.user_data = slot;
+            ring.sq_array[index] = index;
+
+            ++tail;
+            ++next;
+            ++in_flight;
+            ++unsubmitted;
+        }
+        store_release(ring.sq_tail, tail);
+
+        int submitted = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, unsubmitted,
+                                                   in_flight > 0 ? 1u : 0u, IORING_ENTER_GETEVENTS, nullptr, 0));
+        if (submitted < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                // Hard failure: finish this batch (and every later one) synchronously.
+                failed_ = true;
+                for (size_t i = 0; i < names.size(); ++i) {
+                    if (!done[i]) stat_sync(dir_fd, names[i], i, fields, on_complete);
+                }
+                return;
+            }
+        } else {
+            unsubmitted -= static_cast<unsigned>(submitted);
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned cq_tail = load_acquire(ring.cq_tail);
+        for (; head != cq_tail; ++head) {
+            const io_uring_cqe& cqe = ring.cqes[head & *ring.cq_mask];
+            auto slot = static_cast<unsigned>(cqe.user_data);
+            size_t owner = ring.slot_owner[slot];
+
+            if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                // Kernel predates IORING_OP_STATX: answer this one directly.
+                stat_sync(dir_fd, names[owner], owner, fields, on_complete);
+            } else if (cqe.res < 0) {
+                on_complete(owner, FileMetadata{}, std::error_code(-cqe.res, std::generic_category()));
+            } else {
+                FileMetadata metadata;
+                fill_metadata(ring.buffers[slot], metadata);
+                on_complete(owner, metadata, std::error_code{});
+            }
+
+            done[owner] = 1;
+            ring.free_slots.push_back(slot);
+            --in_flight;
+        }
+        store_release(ring.cq_head, head);
+    }
+}
+
+#else
+
+struct UringStatEngine::Ring {};
+
+UringStatEngine::UringStatEngine(unsigned) {}
+
+UringStatEngine::~UringStatEngine() = default;
+
+void UringStatEngine::stat_batch(int dir_fd, const std::vector<const char*>& names, unsigned fields, const Completion& on_complete) {
+    for (size_t i = 0; i < names.size(); ++i) stat_sync(dir_fd, names[i], i, fields, on_complete);
+}
+
+#endif
+
+void UringStatEngine::stat_sync(int dir_fd, const char* name, size_t index, unsigned fields, const Completion& on_complete) {
+    FileMetadata metadata;
+    std::error_code ec;
+    read_metadata(dir_fd, name, fields, metadata, ec);
+    on_complete(index, metadata, ec);
+}
+
+} // namespace analyzer
@@ -1,18 +1,76 @@
+#include "DirectoryWatcher.hpp"
+#include "DuplicateFinder.hpp"
 #include "FileSystemAnalyzer.hpp"
+#include "Inventory.hpp"
 #include "LogAnalyzer.hpp"
 #include "ReportGenerator.hpp"
+#include "ScanProgress.hpp"
+#include "ShardState.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <memory>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <random>
+
+namespace {
+
+// Set on SIGINT or SIGTERM: the scan stops at the next directory and the
+// report covers what was read. A second signal terminates as usual.
+std::atomic<bool> interrupted{false};
+static_assert(std::atomic<bool>::is_always_lock_free);
+
+void on_interrupt(int signal) {
+    interrupted.store(true, std::memory_order_relaxed);
+    std::signal(signal, SIG_DFL);
+}
+
+} // namespace
 
 void print_usage() {
     std::cout << "Usage: FileStatAnalyzer <command> <path> [options]\n\n";
     std::cout << "Commands:\n";
     std::cout << "  fs <dir>     Analyze file system statistics\n";
-    std::cout << "  log <file>   Analyze log file statistics\n\n";
+    std::cout << "  dup <dir>    Find duplicate files (size, then head/tail hash, then full hash)\n";
+    std::cout << "  log <file>   Analyze log file statistics\n";
+    std::cout << "  merge <state files...>  Combine the --state files of a sharded fs scan into one report\n";
+    std::cout << "  diff <old> <new>  Compare two --inventory files: what grew, shrank, appeared or disappeared\n\n";
     std::cout << "Options:\n";
     std::cout << "  --json       Output in JSON format (default: text)\n";
+    std::cout << "  --threads=N  Parallel directory scan with N workers (0 = all cores)\n";
+    std::cout << "  --backend=portable|native  Directory traversal engine (native: Linux getdents64)\n";
+    std::cout << "  --stat-engine=sync|uring   Per-file stat engine (uring: batched io_uring statx, native backend)\n";
+    std::cout << "  --cache=FILE Reuse per-directory results from FILE for unchanged directories, then update it\n";
+    std::cout << "  --include=GLOB  Count only matching files (repeatable)\n";
+    std::cout << "  --exclude=GLOB  Skip matching files and prune matching directories (repeatable)\n";
+    std::cout << "  --gitignore  Skip files and directories ignored by .gitignore/.ignore files in the tree\n";
+    std::cout << "  --one-file-system  Do not cross into mounts of other devices\n";
+    std::cout << "  --scan-pseudo-fs   Also descend into proc, sysfs and other pseudo filesystems (skipped by default)\n";
+    std::cout << "  --top=N      Entries in each top-N file and directory list (default 10)\n";
+    std::cout << "  --rank=LIST  Extra file rankings, comma separated: atime (least recently accessed), ctime (recently changed)\n";
+    std::cout << "  --histogram-precision=B  Size percentiles accurate to 1/2^B of the value (0-8, default 3)\n";
+    std::cout << "  --memory-budget=MB  Cap the memory of extension tables, hard-link tracking and directory rankings\n";
+    std::cout << "  --sample=F   Enter each subdirectory with probability F (0-1) and extrapolate, with 95% margins\n";
+    std::cout << "  --sample-time=S     Stop a sampled scan after S seconds\n";
+    std::cout << "  --sample-entries=N  Stop a sampled scan after reading N entries\n";
+    std::cout << "  --sample-seed=N     Seed for --sample (default: random)\n";
+    std::cout << "  --max-stats=N   Background mode: at most N stat calls per second\n";
+    std::cout << "  --max-read=MB   Background mode: at most MB megabytes read per second (directories, dup contents)\n";
+    std::cout << "  --latency-target=MS  Shrink the --max-stats/--max-read caps while I/O takes over MS per operation\n";
+    std::cout << "  --idle-io    Use the idle I/O priority class\n";
+    std::cout << "  --count-hard-links  Count every link to a file instead of each inode once\n";
+    std::cout << "  --follow-symlinks   Follow symlinks, scanning each directory once however many links reach it\n";
+    std::cout << "  --owners     Report files and bytes per user and group\n";
+    std::cout << "  --shard=I/N  Scan only the top-level entries of shard I (0-based) of N\n";
+    std::cout << "  --state=FILE Save the fs results to FILE for merge instead of printing a report\n";
+    std::cout << "  --inventory=FILE  Also write a sorted inventory of every file and directory to FILE, for diff\n";
+    std::cout << "  --time-limit=S  Stop the fs scan after S seconds and report what was read, marked partial (exit code 2)\n";
+    std::cout << "  --progress[=S]  Print progress to stderr every S seconds (default 2), with an ETA from the last run\n";
+    std::cout << "  --watch[=S]  Keep the fs report up to date from change events, reprinting every S seconds (default 60)\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -27,6 +85,38 @@ int main(int argc, char* argv[]) {
     int depth = -1;
     uint64_t min_size = 0;
     std::string regex_pattern;
+    unsigned threads = 1;
+    auto backend = analyzer::TraversalBackend::Portable;
+    auto stat_engine = analyzer::MetadataEngine::Sync;
+    std::string cache_path;
+    int watch_interval = 0;
+    bool count_hard_links = false;
+    bool owner_usage = false;
+    bool follow_symlinks = false;
+    size_t top_count = 10;
+    std::vector<std::string> include_patterns;
+    std::vector<std::string> exclude_patterns;
+    bool use_ignore_files = false;
+    bool one_file_system = false;
+    bool skip_pseudo_filesystems = true;
+    unsigned histogram_precision = analyzer::SizeHistogram::kDefaultPrecision;
+    unsigned rankings = analyzer::kDefaultRankings;
+    unsigned shard_index = 0;
+    unsigned shard_count = 1;
+    std::string state_path;
+    size_t memory_budget = 0;
+    double max_stats_per_second = 0;
+    double max_read_bytes_per_second = 0;
+    int latency_target_ms = 0;
+    bool idle_io_priority = false;
+    double sample_fraction = 1;
+    uint64_t sample_seed = std::random_device{}();
+    int sample_seconds = 0;
+    uint64_t sample_entries = 0;
+    std::string inventory_path;
+    int progress_interval = 0;
+    int time_limit_seconds = 0;
+    std::vector<std::string> input_files{path}; // merge and diff take several
 
     for (int i = 3; i < argc; ++i) {
         std::string arg = argv[i];
@@ -38,6 +128,105 @@ int main(int argc, char* argv[]) {
             min_size = std::stoull(arg.substr(11));
         } else if (arg.starts_with("--regex=") && arg.length() > 8) {
             regex_pattern = arg.substr(8);
+        } else if (arg.starts_with("--threads=") && arg.length() > 10) {
+            threads = static_cast<unsigned>(std::stoul(arg.substr(10)));
+            if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg == "--backend=native") {
+            backend = analyzer::TraversalBackend::Native;
+        } else if (arg == "--backend=portable") {
+            backend = analyzer::TraversalBackend::Portable;
+        } else if (arg == "--stat-engine=uring") {
+            stat_engine = analyzer::MetadataEngine::IoUring;
+        } else if (arg == "--stat-engine=sync") {
+            stat_engine = analyzer::MetadataEngine::Sync;
+        } else if (arg.starts_with("--cache=") && arg.length() > 8) {
+            cache_path = arg.substr(8);
+        } else if (arg.starts_with("--top=") && arg.length() > 6) {
+            top_count = std::stoul(arg.substr(6));
+        } else if (arg.starts_with("--include=") && arg.length() > 10) {
+            include_patterns.push_back(arg.substr(10));
+        } else if (arg.starts_with("--exclude=") && arg.length() > 10) {
+            exclude_patterns.push_back(arg.substr(10));
+        } else if (arg == "--one-file-system") {
+            one_file_system = true;
+        } else if (arg == "--scan-pseudo-fs") {
+            skip_pseudo_filesystems = false;
+        } else if (arg == "--gitignore") {
+            use_ignore_files = true;
+        } else if (arg.starts_with("--histogram-precision=") && arg.length() > 22) {
+            histogram_precision = static_cast<unsigned>(std::stoul(arg.substr(22)));
+            if (histogram_precision > analyzer::SizeHistogram::kMaxPrecision) {
+                std::cerr << "Warning: histogram precision capped at " << analyzer::SizeHistogram::kMaxPrecision << std::endl;
+                histogram_precision = analyzer::SizeHistogram::kMaxPrecision;
+            }
+        } else if (arg.starts_with("--rank=") && arg.length() > 7) {
+            std::stringstream list(arg.substr(7));
+            for (std::string name; std::getline(list, name, ',');) {
+                if (name == "atime") {
+                    rankings |= analyzer::ranking_bit(analyzer::Ranking::LeastAccessed);
+                } else if (name == "ctime") {
+                    rankings |= analyzer::ranking_bit(analyzer::Ranking::RecentlyChanged);
+                } else {
+                    std::cerr << "Warning: unknown ranking '" << name << "' ignored" << std::endl;
+                }
+            }
+        } else if (arg.starts_with("--shard=") && arg.length() > 8) {
+            std::string spec = arg.substr(8);
+            size_t slash = spec.find('/');
+            if (slash == std::string::npos || slash == 0 || slash + 1 == spec.size()) {
+                std::cerr << "Invalid shard '" << spec << "', expected I/N" << std::endl;
+                return 1;
+            }
+            shard_index = static_cast<unsigned>(std::stoul(spec.substr(0, slash)));
+            shard_count = static_cast<unsigned>(std::stoul(spec.substr(slash + 1)));
+            if (shard_count == 0 || shard_index >= shard_count) {
+                std::cerr << "Invalid shard '" << spec << "': need 0 <= I < N" << std::endl;
+                return 1;
+            }
+        } else if (arg.starts_with("--state=") && arg.length() > 8) {
+            state_path = arg.substr(8);
+        } else if (arg.starts_with("--inventory=") && arg.length() > 12) {
+            inventory_path = arg.substr(12);
+        } else if (arg.starts_with("--memory-budget=") && arg.length() > 16) {
+            memory_budget = std::stoull(arg.substr(16)) * 1024 * 1024;
+        } else if (arg.starts_with("--sample=") && arg.length() > 9) {
+            sample_fraction = std::stod(arg.substr(9));
+            if (sample_fraction <= 0 || sample_fraction > 1) {
+                std::cerr << "Invalid sample fraction '" << arg.substr(9) << "', expected 0 < F <= 1" << std::endl;
+                return 1;
+            }
+        } else if (arg.starts_with("--sample-time=") && arg.length() > 14) {
+            sample_seconds = std::stoi(arg.substr(14));
+        } else if (arg.starts_with("--sample-entries=") && arg.length() > 17) {
+            sample_entries = std::stoull(arg.substr(17));
+        } else if (arg.starts_with("--sample-seed=") && arg.length() > 14) {
+            sample_seed = std::stoull(arg.substr(14));
+        } else if (arg.starts_with("--max-stats=") && arg.length() > 12) {
+            max_stats_per_second = std::stod(arg.substr(12));
+        } else if (arg.starts_with("--max-read=") && arg.length() > 11) {
+            max_read_bytes_per_second = std::stod(arg.substr(11)) * 1024 * 1024;
+        } else if (arg.starts_with("--latency-target=") && arg.length() > 17) {
+            latency_target_ms = std::stoi(arg.substr(17));
+        } else if (arg == "--idle-io") {
+            idle_io_priority = true;
+        } else if (arg == "--count-hard-links") {
+            count_hard_links = true;
+        } else if (arg == "--follow-symlinks") {
+            follow_symlinks = true;
+        } else if (arg == "--owners") {
+            owner_usage = true;
+        } else if (arg.starts_with("--time-limit=") && arg.length() > 13) {
+            time_limit_seconds = std::max(1, std::stoi(arg.substr(13)));
+        } else if (arg == "--progress") {
+            progress_interval = 2;
+        } else if (arg.starts_with("--progress=") && arg.length() > 11) {
+            progress_interval = std::max(1, std::stoi(arg.substr(11)));
+        } else if (arg == "--watch") {
+            watch_interval = 60;
+        } else if (arg.starts_with("--watch=") && arg.length() > 8) {
+            watch_interval = std::max(1, std::stoi(arg.substr(8)));
+        } else if (!arg.starts_with("--")) {
+            input_files.push_back(arg);
         }
     }
 
@@ -48,14 +237,179 @@ int main(int argc, char* argv[]) {
         generator = std::make_unique<analyzer::TextReportGenerator>();
     }
 
-    if (command == "fs") {
+    if (command == "fs" || command == "dup") {
         analyzer::AnalysisOptions options;
         options.target_path = path;
         options.max_depth = depth;
         options.min_size_threshold = min_size;
+        options.thread_count = threads;
+        options.backend = backend;
+        options.metadata_engine = stat_engine;
+        options.cache_path = cache_path;
+        options.count_hard_links = count_hard_links;
+        options.owner_usage = owner_usage;
+        options.follow_symlinks = follow_symlinks;
+        options.top_count = top_count;
+        options.histogram_precision = histogram_precision;
+        options.include_patterns = include_patterns;
+        options.exclude_patterns = exclude_patterns;
+        options.use_ignore_files = use_ignore_files;
+        options.one_file_system = one_file_system;
+        options.skip_pseudo_filesystems = skip_pseudo_filesystems;
+        options.rankings = rankings;
+        options.shard_index = shard_index;
+        options.shard_count = shard_count;
+        options.memory_budget = memory_budget;
+        options.max_stats_per_second = max_stats_per_second;
+        options.max_read_bytes_per_second = max_read_bytes_per_second;
+        options.latency_target = std::chrono::milliseconds(latency_target_ms);
+        options.idle_io_priority = idle_io_priority;
+        options.sample_fraction = sample_fraction;
+        options.sample_seed = sample_seed;
+        options.sample_time_budget = std::chrono::seconds(sample_seconds);
+        options.sample_entry_budget = sample_entries;
+        if (sample_fraction < 1 && (command == "dup" || watch_interval > 0 || !state_path.empty())) {
+            // Estimates cannot find duplicates, be kept current or be merged.
+            std::cerr << "--sample works with a plain fs scan only" << std::endl;
+            return 1;
+        }
+        if (!inventory_path.empty() && (command == "dup" || watch_interval > 0 || sample_fraction < 1)) {
+            std::cerr << "--inventory works with a plain fs scan only" << std::endl;
+            return 1;
+        }
+        if (time_limit_seconds > 0 && (command == "dup" || watch_interval > 0)) {
+            std::cerr << "--time-limit works with a plain fs scan only" << std::endl;
+            return 1;
+        }
+        if (latency_target_ms > 0 && max_stats_per_second <= 0 && max_read_bytes_per_second <= 0) {
+            // The target scales the caps down; without one there is nothing to scale.
+            std::cerr << "--latency-target needs --max-stats or --max-read" << std::endl;
+            return 1;
+        }
+        if (progress_interval > 0 && watch_interval > 0) {
+            std::cerr << "--progress cannot be combined with --watch" << std::endl;
+            return 1;
+        }
+        // The reporter runs for the scan only. What a full scan took is saved
+        // for the next run's ETA; a sampled one would understate it.
+        analyzer::ScanProgress progress;
+        std::unique_ptr<analyzer::ProgressReporter> reporter;
+        std::string progress_key;
+        const auto scan_start = std::chrono::steady_clock::now();
+        auto start_progress = [&](const std::string& key) {
+            if (progress_interval == 0) return;
+            options.progress = &progress;
+            progress_key = key;
+            reporter = std::make_unique<analyzer::ProgressReporter>(progress, std::chrono::seconds(progress_interval),
+                                                                    analyzer::load_scan_record(key));
+        };
+        auto finish_progress = [&]() {
+            if (!reporter) return;
+            reporter->stop();
+            if (sample_fraction < 1) return;
+            const auto totals = progress.total();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scan_start).count();
+            analyzer::save_scan_record(progress_key, {totals.directories, totals.files, totals.size, seconds});
+        };
+        std::error_code ec;
+        const std::string target = fs::weakly_canonical(path, ec).string();
+        if (command == "dup") {
+            start_progress("dup\n" + target + "\nmin_size=" + std::to_string(min_size));
+            analyzer::DuplicateFinder finder(options);
+            auto report = finder.find();
+            finish_progress();
+            std::cout << generator->generate_dup_report(report) << std::endl;
+            return 0;
+        }
+        if (watch_interval > 0) {
+            if (shard_count > 1 || !state_path.empty()) {
+                std::cerr << "--shard and --state cannot be combined with --watch" << std::endl;
+                return 1;
+            }
+            if (follow_symlinks) {
+                // Change events arrive for a directory's real path, not the links to it.
+                std::cerr << "--follow-symlinks cannot be combined with --watch" << std::endl;
+                return 1;
+            }
+            if (memory_budget != 0) {
+                // The watcher keeps a snapshot of every directory.
+                std::cerr << "--memory-budget cannot be combined with --watch" << std::endl;
+                return 1;
+            }
+            analyzer::DirectoryWatcher watcher(options);
+            bool watched = watcher.run(std::chrono::seconds(watch_interval), [&](const analyzer::DirectoryStats& stats) {
+                std::cout << generator->generate_fs_report(stats) << std::endl;
+            });
+            return watched ? 0 : 1;
+        }
+        std::unique_ptr<analyzer::InventoryWriter> inventory;
+        if (!inventory_path.empty()) {
+            if (!options.cache_path.empty()) {
+                // Replayed directories do not report their files.
+                std::cerr << "Warning: scan cache is not used while writing an inventory" << std::endl;
+                options.cache_path.clear();
+            }
+            size_t buffer = analyzer::InventoryWriter::kDefaultBufferBytes;
+            if (memory_budget != 0) buffer = std::min(buffer, memory_budget / 2);
+            inventory = std::make_unique<analyzer::InventoryWriter>(inventory_path, path, buffer);
+            options.on_file = [&](const analyzer::FileEntry& entry, const analyzer::FileMetadata&) { inventory->add_file(entry); };
+            options.on_directory = [&](const analyzer::DirectoryTask& task) { inventory->add_directory(task.path); };
+        }
+        if (progress_interval > 0) {
+            start_progress("fs\n" + target + "\n" + analyzer::FileSystemAnalyzer(options).fingerprint() + ";shard=" +
+                           std::to_string(shard_index) + "/" + std::to_string(shard_count));
+        }
+        // From here on an interrupt yields a partial report instead of nothing.
+        options.time_limit = std::chrono::seconds(time_limit_seconds);
+        options.cancel = &interrupted;
+        std::signal(SIGINT, on_interrupt);
+        std::signal(SIGTERM, on_interrupt);
         analyzer::FileSystemAnalyzer analyzer(options);
         auto stats = analyzer.analyze();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        if (stats.partial) {
+            std::cerr << "Warning: " << (interrupted ? "interrupted" : "time limit reached") << "; "
+                      << stats.directories_unvisited << " directories were not read, the results are partial" << std::endl;
+            if (inventory) {
+                // A diff against it would report the unread subtrees as deleted.
+                std::cerr << "Warning: inventory " << inventory_path << " not written for a partial scan" << std::endl;
+                inventory.reset();
+            }
+        } else {
+            finish_progress();
+        }
+        if (reporter) reporter->stop();
+        if (inventory && !inventory->finish()) {
+            std::cerr << "Could not write inventory " << inventory_path << std::endl;
+            return 1;
+        }
+        if (!state_path.empty()) {
+            analyzer::ShardState state{path, shard_index, shard_count, analyzer.fingerprint(), std::move(stats)};
+            if (!analyzer::save_shard_state(state_path, state)) {
+                std::cerr << "Could not write shard state " << state_path << std::endl;
+                return 1;
+            }
+            return state.stats.partial ? 2 : 0;
+        }
         std::cout << generator->generate_fs_report(stats) << std::endl;
+        if (stats.partial) return 2;
+    } else if (command == "merge") {
+        std::vector<analyzer::ShardState> states(input_files.size());
+        for (size_t i = 0; i < input_files.size(); ++i) {
+            if (!analyzer::load_shard_state(input_files[i], states[i])) return 1;
+        }
+        const analyzer::DirectoryStats merged = analyzer::merge_shard_states(states);
+        std::cout << generator->generate_fs_report(merged) << std::endl;
+        if (merged.partial) return 2;
+    } else if (command == "diff") {
+        if (input_files.size() != 2) {
+            std::cerr << "diff takes two inventory files, old and new" << std::endl;
+            return 1;
+        }
+        analyzer::InventoryDiff diff;
+        if (!analyzer::diff_inventories(input_files[0], input_files[1], top_count, diff)) return 1;
+        std::cout << generator->generate_diff_report(diff) << std::endl;
     } else if (command == "log") {
         analyzer::LogAnalyzer analyzer;
         analyzer::LogFilterOptions options;
@@ -0,0 +1,102 @@
+#pragma once
+
+// Shared helpers of the test executables: a CHECK macro that records
+// failures and carries on, scratch directories, and a small file tree with
+// fixed sizes and mtimes so that every scan of it reports the same figures.
+#include "FileSystemAnalyzer.hpp"
+#include "ReportGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace test {
+
+inline int failures = 0;
+
+#define CHECK(condition)                                                                              \
+    do {                                                                                              \
+        if (!(condition)) {                                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            ++test::failures;                                                                         \
+        }                                                                                             \
+    } while (false)
+
+// Exit status of the test executable.
+inline int result() {
+    if (failures != 0) std::cerr << failures << " check(s) failed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// A fresh directory under the system temp directory, removed with everything in it.
+class TempDir {
+public:
+    explicit TempDir(const std::string& name) {
+        path_ = fs::temp_directory_path() / (name + "-" + std::to_string(std::random_device{}()));
+        fs::create_directories(path_);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const fs::path& path() const { return path_; }
+
+private:
+    fs::path path_;
+};
+
+// `size` bytes, last modified `age` before now.
+inline void write_file(const fs::path& path, uint64_t size, std::chrono::hours age = std::chrono::hours(1)) {
+    fs::create_directories(path.parent_path());
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::string block(4096, 'x');
+        for (uint64_t left = size; left > 0;) {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(left, block.size()));
+            out.write(block.data(), static_cast<std::streamsize>(n));
+            left -= n;
+        }
+    }
+    fs::last_write_time(path, fs::file_time_type::clock::now() - age);
+}
+
+// A few hundred files over nested directories, with assorted extensions,
+// sizes and ages (away from the age bucket limits), a hidden file, an empty
+// directory and a symlink, which scans do not follow by default.
+inline void make_tree(const fs::path& root) {
+    static const char* extensions[] = {".txt", ".log", ".cpp", ".json", ".bin", ""};
+    static const int ages[] = {1, 3 * 24, 14 * 24, 60 * 24, 400 * 24};
+    std::mt19937_64 rng(7);
+    for (int top = 0; top < 6; ++top) {
+        const fs::path dir = root / ("dir" + std::to_string(top));
+        for (int sub = 0; sub < 4; ++sub) {
+            const fs::path subdir = sub == 0 ? dir : dir / ("sub" + std::to_string(sub)) / "deep";
+            for (int i = 0; i < 12; ++i) {
+                const std::string name = "file" + std::to_string(i) + extensions[rng() % std::size(extensions)];
+                write_file(subdir / name, rng() % 200000, std::chrono::hours(ages[rng() % std::size(ages)]));
+            }
+        }
+    }
+    write_file(root / "top.txt", 123456, std::chrono::hours(2));
+    write_file(root / ".hidden", 999);
+    fs::create_directories(root / "empty");
+    fs::create_symlink(root / "dir0", root / "link");
+}
+
+// The JSON report of a scan, which holds every figure a user sees.
+inline std::string report(const analyzer::DirectoryStats& stats) {
+    return analyzer::JsonReportGenerator().generate_fs_report(stats);
+}
+
+inline analyzer::DirectoryStats scan(analyzer::AnalysisOptions options) {
+    return analyzer::FileSystemAnalyzer(std::move(options)).analyze();
+}
+
+} // namespace test
@@ -0,0 +1,36 @@
+// The serial, parallel, native and io_uring scans of one tree must report
+// the same figures.
+#include "TestSupport.hpp"
+
+using namespace analyzer;
+
+int main() {
+    test::TempDir dir("fsa-backend");
+    test::make_tree(dir.path());
+
+    AnalysisOptions options;
+    options.target_path = dir.path();
+    options.owner_usage = true;
+    const std::string serial = test::report(test::scan(options));
+
+    AnalysisOptions parallel = options;
+    parallel.thread_count = 4;
+    CHECK(test::report(test::scan(parallel)) == serial);
+
+    AnalysisOptions native = options;
+    native.backend = TraversalBackend::Native;
+    CHECK(test::report(test::scan(native)) == serial);
+
+    native.thread_count = 4;
+    CHECK(test::report(test::scan(native)) == serial);
+
+    AnalysisOptions uring = native;
+    uring.metadata_engine = MetadataEngine::IoUring;
+    uring.uring_queue_depth = 8;
+    CHECK(test::report(test::scan(uring)) == serial);
+
+    uring.thread_count = 1;
+    CHECK(test::report(test::scan(uring)) == serial);
+
+    return test::result();
+}
@@ -0,0 +1,159 @@
+// Inventories read back exactly what was written, in inventory order,
+// whether or not the writer spilled runs; diff_inventories reports what
+// changed between two scans.
+#include "Inventory.hpp"
+#include "TestSupport.hpp"
+#include <algorithm>
+#include <map>
+#include <thread>
+
+using namespace analyzer;
+
+namespace {
+
+std::vector<InventoryRecord> read_all(const fs::path& file) {
+    std::vector<InventoryRecord> records;
+    InventoryReader reader;
+    CHECK(reader.open(file));
+    InventoryRecord record;
+    while (reader.next(record)) records.push_back(record);
+    CHECK(!reader.failed());
+    return records;
+}
+
+bool same(const InventoryRecord& a, const InventoryRecord& b) {
+    return a.path == b.path && a.directory == b.directory && a.size == b.size && a.allocated_size == b.allocated_size &&
+           a.mtime == b.mtime;
+}
+
+// Paths sharing long prefixes, and names around the separator that byte
+// order would put in another place ("a.b" < "a/b" bytewise).
+std::vector<InventoryRecord> sample_records() {
+    std::vector<InventoryRecord> records;
+    const fs::file_time_type::rep base = fs::file_time_type::clock::now().time_since_epoch().count();
+    for (int d = 0; d < 40; ++d) {
+        const std::string dir = "project/src/module" + std::to_string(d);
+        records.push_back({dir, true});
+        for (int f = 0; f < 50; ++f) {
+            const uint64_t size = static_cast<uint64_t>(d) * 1000 + static_cast<uint64_t>(f);
+            records.push_back({dir + "/file" + std::to_string(f) + ".cpp", false, size, size + 4096, base - d * 1000 - f});
+        }
+    }
+    records.push_back({"", true});
+    records.push_back({"project", true});
+    records.push_back({"project/src", true});
+    records.push_back({"a", true});
+    records.push_back({"a/b", false, 1, 4096, base});
+    records.push_back({"a.b", false, 2, 4096, -base}); // before the epoch
+    records.push_back({"a-b", false, 3, 4096, 0});
+    return records;
+}
+
+void check_round_trip(const fs::path& dir, size_t buffer_bytes, unsigned threads) {
+    const fs::path root = "/data";
+    std::vector<InventoryRecord> records = sample_records();
+    const fs::path file = dir / "round-trip.inv";
+    {
+        InventoryWriter writer(file, root, buffer_bytes);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t i = t; i < records.size(); i += threads) {
+                    const InventoryRecord& record = records[i];
+                    if (record.directory) {
+                        writer.add_directory(root / record.path);
+                        continue;
+                    }
+                    FileEntry entry{root / record.path, record.size, record.allocated_size, "",
+                                    fs::file_time_type(fs::file_time_type::duration(record.mtime))};
+                    writer.add_file(entry);
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        CHECK(writer.finish());
+    }
+    // The writer leaves no spilled runs behind.
+    CHECK(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 1);
+
+    std::sort(records.begin(), records.end(),
+              [](const InventoryRecord& a, const InventoryRecord& b) { return inventory_order(a.path, b.path); });
+    const std::vector<InventoryRecord> read = read_all(file);
+    CHECK(read.size() == records.size());
+    CHECK(std::equal(read.begin(), read.end(), records.begin(), records.end(), same));
+    fs::remove(file);
+}
+
+// Inventory of a real scan, written as `fs --inventory` does.
+void write_inventory(const fs::path& target, const fs::path& file) {
+    InventoryWriter writer(file, target, 1024);
+    AnalysisOptions options;
+    options.target_path = target;
+    options.thread_count = 4;
+    options.on_file = [&](const FileEntry& entry, const FileMetadata&) { writer.add_file(entry); };
+    options.on_directory = [&](const DirectoryTask& task) { writer.add_directory(task.path); };
+    test::scan(options);
+    CHECK(writer.finish());
+}
+
+void check_diff(const fs::path& dir) {
+    const fs::path tree = dir / "tree";
+    test::make_tree(tree);
+    write_inventory(tree, dir / "old.inv");
+
+    std::map<std::string, InventoryRecord> old_files;
+    for (const auto& record : read_all(dir / "old.inv")) {
+        if (!record.directory) old_files[record.path] = record;
+    }
+    CHECK(old_files.size() > 100);
+    CHECK(old_files.count("top.txt") == 1);
+    CHECK(old_files.count(".hidden") == 0);
+
+    // One file grows, one shrinks, one is touched, one goes and one comes.
+    auto it = old_files.begin();
+    const InventoryRecord grown = (it++)->second;
+    const InventoryRecord shrunk = (it++)->second;
+    const InventoryRecord touched = (it++)->second;
+    const InventoryRecord removed = (it++)->second;
+    test::write_file(tree / grown.path, grown.size + 5000);
+    test::write_file(tree / shrunk.path, 0);
+    fs::last_write_time(tree / touched.path, fs::last_write_time(tree / touched.path) - std::chrono::hours(1));
+    fs::remove(tree / removed.path);
+    test::write_file(tree / "dir0" / "appeared.dat", 321);
+    write_inventory(tree, dir / "new.inv");
+
+    InventoryDiff diff;
+    CHECK(diff_inventories(dir / "old.inv", dir / "new.inv", 10, diff));
+    CHECK(diff.old_files == old_files.size());
+    CHECK(diff.new_files == old_files.size());
+    CHECK(diff.files_modified == (shrunk.size > 0 ? 1u : 2u)); // an empty file "shrunk" to 0 is only touched
+    const auto& files = diff.files;
+    CHECK(files[static_cast<size_t>(Change::Grew)].count == 1);
+    CHECK(files[static_cast<size_t>(Change::Shrank)].count == (shrunk.size > 0 ? 1u : 0u));
+    CHECK(files[static_cast<size_t>(Change::Disappeared)].count == 1);
+    CHECK(files[static_cast<size_t>(Change::Disappeared)].largest.at(0).path == removed.path);
+    CHECK(files[static_cast<size_t>(Change::Appeared)].count == 1);
+    CHECK(files[static_cast<size_t>(Change::Appeared)].largest.at(0).path == "dir0/appeared.dat");
+    CHECK(diff.new_size + removed.size + shrunk.size == diff.old_size + 5000 + 321);
+
+    // An inventory against itself has no changes.
+    InventoryDiff none;
+    CHECK(diff_inventories(dir / "new.inv", dir / "new.inv", 10, none));
+    for (const auto& set : none.files) CHECK(set.count == 0);
+    for (const auto& set : none.directories) CHECK(set.count == 0);
+    CHECK(none.files_modified == 0);
+}
+
+} // namespace
+
+int main() {
+    for (size_t buffer_bytes : {InventoryWriter::kDefaultBufferBytes, size_t{4096}}) {
+        for (unsigned threads : {1u, 4u}) {
+            test::TempDir dir("fsa-inventory");
+            check_round_trip(dir.path(), buffer_bytes, threads);
+        }
+    }
+    test::TempDir dir("fsa-diff");
+    check_diff(dir.path());
+    return test::result();
+}
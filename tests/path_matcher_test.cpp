@@ -0,0 +1,146 @@
+// Glob syntax, --include/--exclude and .gitignore semantics, on their own
+// and through a scan.
+#include "IgnoreRules.hpp"
+#include "PathMatcher.hpp"
+#include "TestSupport.hpp"
+#include <fstream>
+
+using namespace analyzer;
+
+namespace {
+
+GlobSet globs(std::initializer_list<const char*> patterns) {
+    GlobSet set;
+    for (const char* pattern : patterns) CHECK(set.add(pattern));
+    return set;
+}
+
+void check_globs() {
+    GlobSet empty;
+    CHECK(!empty.add(""));
+    CHECK(empty.empty());
+    CHECK(!empty.matches("", "anything"));
+
+    // Plain names and "*.ext" match at any depth.
+    const GlobSet names = globs({"node_modules", "*.o"});
+    CHECK(names.matches("", "node_modules"));
+    CHECK(names.matches("a/b", "node_modules"));
+    CHECK(names.matches("src", "main.o"));
+    CHECK(!names.matches("src", "main.oo"));
+    CHECK(!names.matches("node_modules", "package.json"));
+
+    // * and ? stay within a component, ** crosses them.
+    const GlobSet wild = globs({"test_?.c", "lib*.so.*", "build/*/obj", "docs/**/*.md"});
+    CHECK(wild.matches("x", "test_1.c"));
+    CHECK(!wild.matches("x", "test_12.c"));
+    CHECK(wild.matches("", "libfoo.so.1"));
+    CHECK(wild.matches("build/debug", "obj"));
+    CHECK(!wild.matches("build/debug/x", "obj"));
+    CHECK(!wild.matches("sub/build/debug", "obj")); // a slash anchors the pattern
+    CHECK(wild.matches("docs", "a.md"));
+    CHECK(wild.matches("docs/x/y", "a.md"));
+    CHECK(!wild.matches("src/docs", "a.md"));
+
+    // Classes, negated classes and escapes.
+    const GlobSet classes = globs({"[a-c]x", "[!0-9]y", "\\*star", "/rooted"});
+    CHECK(classes.matches("", "bx"));
+    CHECK(!classes.matches("", "dx"));
+    CHECK(classes.matches("", "ay"));
+    CHECK(!classes.matches("", "5y"));
+    CHECK(classes.matches("", "*star"));
+    CHECK(!classes.matches("", "xstar"));
+    CHECK(classes.matches("", "rooted"));
+    CHECK(!classes.matches("sub", "rooted"));
+}
+
+void check_path_matcher() {
+    CHECK(PathMatcher().empty());
+    CHECK(PathMatcher().accepts_file("", "a.txt"));
+
+    const PathMatcher matcher({"*.cpp", "*.hpp"}, {"build", "*.tmp.cpp", "vendor/"});
+    CHECK(!matcher.empty());
+    CHECK(matcher.accepts_file("src", "main.cpp"));
+    CHECK(!matcher.accepts_file("src", "main.c"));
+    CHECK(!matcher.accepts_file("src", "gen.tmp.cpp"));
+    // Inclusions select files only; exclusions prune directories too.
+    CHECK(!matcher.excludes_directory("", "src"));
+    CHECK(matcher.excludes_directory("a", "build"));
+    CHECK(matcher.excludes_directory("", "vendor"));
+    CHECK(matcher.accepts_file("", "vendor.cpp")); // "vendor/" is for directories only
+}
+
+void check_ignore_rules() {
+    IgnoreRules rules;
+    rules.parse("# comment\n"
+                "*.log\n"
+                "!keep.log\n"
+                "out/\n"
+                "/local\n"
+                "trailing   \n"
+                "escaped\\ \r\n");
+    CHECK(rules.match("", "a.log", false) == IgnoreRules::Verdict::Ignore);
+    CHECK(rules.match("deep/er", "b.log", false) == IgnoreRules::Verdict::Ignore);
+    CHECK(rules.match("", "keep.log", false) == IgnoreRules::Verdict::Keep); // the last matching rule wins
+    CHECK(rules.match("", "out", true) == IgnoreRules::Verdict::Ignore);
+    CHECK(rules.match("", "out", false) == IgnoreRules::Verdict::None);
+    CHECK(rules.match("", "local", false) == IgnoreRules::Verdict::Ignore);
+    CHECK(rules.match("sub", "local", false) == IgnoreRules::Verdict::None);
+    CHECK(rules.match("", "trailing", false) == IgnoreRules::Verdict::Ignore);
+    CHECK(rules.match("", "escaped ", false) == IgnoreRules::Verdict::Ignore);
+    CHECK(rules.match("", "# comment", false) == IgnoreRules::Verdict::None);
+    CHECK(rules.match("", "a.txt", false) == IgnoreRules::Verdict::None);
+
+    // A nested file overrides its parent's rules below it, and only there.
+    IgnoreFrame root;
+    root.rules.parse("*.log\n");
+    auto parent = std::make_shared<const IgnoreFrame>(std::move(root));
+    IgnoreFrame nested;
+    nested.parent = parent;
+    nested.base = "sub";
+    nested.rules.parse("!important.log\n");
+    CHECK(is_ignored(parent.get(), "", "important.log", false));
+    CHECK(!is_ignored(&nested, "sub", "important.log", false));
+    CHECK(is_ignored(&nested, "sub", "other.log", false));
+    CHECK(!is_ignored(&nested, "sub", "a.txt", false));
+}
+
+// What a scan counts with the same rules in files on disk.
+void check_scan() {
+    test::TempDir dir("fsa-ignore");
+    const fs::path& root = dir.path();
+    test::write_file(root / "a.txt", 1);
+    test::write_file(root / "a.log", 10);
+    test::write_file(root / "keep.log", 100);
+    test::write_file(root / "out" / "x.txt", 1000);
+    test::write_file(root / "sub" / "b.log", 10000);
+    test::write_file(root / "sub" / "important.log", 100000);
+    test::write_file(root / "sub" / "build" / "c.txt", 1000000);
+    std::ofstream(root / ".gitignore") << "*.log\n!keep.log\nout/\n";
+    std::ofstream(root / "sub" / ".ignore") << "!important.log\n";
+
+    AnalysisOptions options;
+    options.target_path = root;
+    options.use_ignore_files = true;
+    options.skip_hidden = false; // the ignore files themselves then count
+    const DirectoryStats ignored = test::scan(options);
+    const uint64_t ignore_files = fs::file_size(root / ".gitignore") + fs::file_size(root / "sub" / ".ignore");
+    CHECK(ignored.total_files == 6);
+    CHECK(ignored.total_size == 1 + 100 + 100000 + 1000000 + ignore_files);
+
+    options.use_ignore_files = false;
+    options.exclude_patterns = {"build", "*.log"};
+    options.include_patterns = {"*.txt", "*.log"};
+    const DirectoryStats filtered = test::scan(options);
+    CHECK(filtered.total_files == 2);
+    CHECK(filtered.total_size == 1 + 1000);
+}
+
+} // namespace
+
+int main() {
+    check_globs();
+    check_path_matcher();
+    check_ignore_rules();
+    check_scan();
+    return test::result();
+}
@@ -0,0 +1,94 @@
+// A scan that replays directories from the cache must report what a full
+// scan of the same tree reports, including after files were added, removed
+// or rewritten in place.
+#include "TestSupport.hpp"
+#include <atomic>
+
+using namespace analyzer;
+
+namespace {
+
+// The report of a cached scan, and how many files it stat'ed rather than
+// replayed (replayed directories do not report their files).
+std::string cached_scan(AnalysisOptions options, uint64_t& files_read) {
+    std::atomic<uint64_t> files{0};
+    options.on_file = [&](const FileEntry&, const FileMetadata&) { files.fetch_add(1, std::memory_order_relaxed); };
+    const std::string report = test::report(test::scan(options));
+    files_read = files.load();
+    return report;
+}
+
+// Rewrites `file` with another size, leaving its directory's mtime alone as
+// an in-place rewrite does.
+void rewrite_in_place(const fs::path& file, uint64_t size) {
+    const fs::file_time_type dir_mtime = fs::last_write_time(file.parent_path());
+    test::write_file(file, size);
+    fs::last_write_time(file.parent_path(), dir_mtime);
+}
+
+// Some regular file directly in `dir`; make_tree puts a dozen in each.
+fs::path some_file(const fs::path& dir) {
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file()) return entry.path();
+    }
+    return {};
+}
+
+void check_replay(const AnalysisOptions& options) {
+    AnalysisOptions full = options;
+    full.cache_path.clear();
+    uint64_t files_read = 0;
+
+    // First run fills the cache, second replays all of it.
+    CHECK(cached_scan(options, files_read) == test::report(test::scan(full)));
+    const uint64_t all_files = files_read;
+    CHECK(all_files > 0);
+    CHECK(cached_scan(options, files_read) == test::report(test::scan(full)));
+    CHECK(files_read == 0);
+
+    const fs::path& root = options.target_path;
+    rewrite_in_place(some_file(root / "dir1"), 777777);
+    CHECK(cached_scan(options, files_read) == test::report(test::scan(full)));
+    CHECK(files_read > 0 && files_read < all_files);
+
+    test::write_file(root / "dir2" / "sub1" / "deep" / "new.txt", 4242);
+    fs::remove(some_file(root / "dir4"));
+    fs::remove_all(root / "dir5" / "sub2");
+    CHECK(cached_scan(options, files_read) == test::report(test::scan(full)));
+    CHECK(cached_scan(options, files_read) == test::report(test::scan(full)));
+    CHECK(files_read == 0);
+}
+
+} // namespace
+
+int main() {
+    {
+        test::TempDir dir("fsa-cache");
+        test::make_tree(dir.path() / "tree");
+        AnalysisOptions options;
+        options.target_path = dir.path() / "tree";
+        options.cache_path = dir.path() / "scan.cache";
+        check_replay(options);
+    }
+    {
+        test::TempDir dir("fsa-cache-parallel");
+        test::make_tree(dir.path() / "tree");
+        AnalysisOptions options;
+        options.target_path = dir.path() / "tree";
+        options.cache_path = dir.path() / "scan.cache";
+        options.thread_count = 4;
+        options.backend = TraversalBackend::Native;
+        options.owner_usage = true;
+        check_replay(options);
+
+        // A torn cache file is ignored, not half used.
+        const uint64_t size = fs::file_size(options.cache_path);
+        fs::resize_file(options.cache_path, size / 2);
+        AnalysisOptions full = options;
+        full.cache_path.clear();
+        uint64_t files_read = 0;
+        CHECK(cached_scan(options, files_read) == test::report(test::scan(full)));
+        CHECK(files_read > 0);
+    }
+    return test::result();
+}
@@ -0,0 +1,57 @@
+// Merging the saved states of every shard must report what one full scan
+// reports; a missing shard leaves the merge partial.
+#include "ShardState.hpp"
+#include "TestSupport.hpp"
+
+using namespace analyzer;
+
+namespace {
+
+std::vector<ShardState> scan_shards(const AnalysisOptions& options, unsigned count, const fs::path& state_dir) {
+    std::vector<ShardState> states(count);
+    for (unsigned i = 0; i < count; ++i) {
+        AnalysisOptions shard = options;
+        shard.shard_index = i;
+        shard.shard_count = count;
+        FileSystemAnalyzer analyzer(shard);
+        ShardState state{options.target_path.string(), i, count, analyzer.fingerprint(), analyzer.analyze()};
+        // Through the file, as `merge` reads them.
+        const fs::path file = state_dir / ("shard" + std::to_string(i));
+        CHECK(save_shard_state(file, state));
+        CHECK(load_shard_state(file, states[i]));
+    }
+    return states;
+}
+
+} // namespace
+
+int main() {
+    test::TempDir dir("fsa-shard");
+    test::make_tree(dir.path() / "tree");
+    fs::create_directories(dir.path() / "states");
+
+    AnalysisOptions options;
+    options.target_path = dir.path() / "tree";
+    options.owner_usage = true;
+    const DirectoryStats full = test::scan(options);
+
+    for (unsigned count : {1u, 3u, 8u}) {
+        std::vector<ShardState> states = scan_shards(options, count, dir.path() / "states");
+        const DirectoryStats merged = merge_shard_states(states);
+        CHECK(!merged.partial);
+        CHECK(test::report(merged) == test::report(full));
+
+        if (count > 1) {
+            states.pop_back();
+            const DirectoryStats incomplete = merge_shard_states(states);
+            CHECK(incomplete.partial);
+            CHECK(incomplete.total_files <= full.total_files);
+        }
+    }
+
+    AnalysisOptions parallel = options;
+    parallel.thread_count = 4;
+    CHECK(test::report(merge_shard_states(scan_shards(parallel, 3, dir.path() / "states"))) == test::report(full));
+
+    return test::result();
+}
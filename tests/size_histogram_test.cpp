@@ -0,0 +1,104 @@
+// SizeHistogram percentiles stay within their stated precision of the exact
+// ones, and merging, removing and restoring keep them.
+#include "SizeHistogram.hpp"
+#include "TestSupport.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace analyzer;
+
+namespace {
+
+// Smallest value such that `percent` % of the sorted values are no larger.
+uint64_t exact_percentile(const std::vector<uint64_t>& sorted, double percent) {
+    const auto rank = static_cast<size_t>(std::ceil(percent / 100 * static_cast<double>(sorted.size())));
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+bool within_precision(uint64_t estimate, uint64_t exact, unsigned precision) {
+    const double error = std::abs(static_cast<double>(estimate) - static_cast<double>(exact));
+    return error <= static_cast<double>(exact) / static_cast<double>(uint64_t{1} << precision);
+}
+
+void check_distribution(const std::vector<uint64_t>& values, unsigned precision) {
+    SizeHistogram histogram(precision);
+    for (uint64_t value : values) histogram.add(value);
+    std::vector<uint64_t> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+
+    CHECK(histogram.total() == values.size());
+    CHECK(histogram.smallest() == sorted.front());
+    CHECK(histogram.largest() == sorted.back());
+    for (double percent : {1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+        const uint64_t estimate = histogram.percentile(percent);
+        CHECK(within_precision(estimate, exact_percentile(sorted, percent), precision));
+        CHECK(estimate >= sorted.front() && estimate <= sorted.back());
+    }
+
+    // Two halves merged equal the whole.
+    SizeHistogram first(precision);
+    SizeHistogram second(precision);
+    for (size_t i = 0; i < values.size(); ++i) (i % 2 == 0 ? first : second).add(values[i]);
+    first.merge(second);
+    CHECK(first.total() == histogram.total());
+    for (double percent : {50.0, 90.0, 99.0}) CHECK(first.percentile(percent) == histogram.percentile(percent));
+
+    // As saved in the scan cache: buckets, then bounds.
+    SizeHistogram restored(precision);
+    for (size_t i = 0; i < histogram.bucket_count(); ++i) restored.add_bucket(i, histogram.bucket(i));
+    restored.restore(histogram.smallest(), histogram.largest());
+    CHECK(restored.smallest() == histogram.smallest());
+    CHECK(restored.largest() == histogram.largest());
+    for (double percent : {50.0, 90.0, 99.0}) CHECK(restored.percentile(percent) == histogram.percentile(percent));
+}
+
+} // namespace
+
+int main() {
+    SizeHistogram empty;
+    CHECK(empty.total() == 0);
+    CHECK(empty.percentile(50) == 0);
+    CHECK(empty.smallest() > empty.largest());
+
+    // Values below 2^precision have buckets of their own.
+    SizeHistogram small(3);
+    for (uint64_t value = 0; value < 8; ++value) small.add(value);
+    CHECK(small.percentile(50) == 3);
+    CHECK(small.percentile(100) == 7);
+    for (uint64_t value = 0; value < 8; ++value) CHECK(small.lowest_in_bucket(small.bucket_of(value)) == value);
+
+    // Every value lies in its bucket, and buckets tile the range.
+    for (unsigned precision : {0u, 3u, 8u}) {
+        SizeHistogram histogram(precision);
+        for (uint64_t value : {uint64_t{0}, uint64_t{1}, uint64_t{255}, uint64_t{256}, uint64_t{4097}, uint64_t{1} << 40,
+                               ~uint64_t{0}}) {
+            const size_t bucket = histogram.bucket_of(value);
+            CHECK(histogram.lowest_in_bucket(bucket) <= value && value <= histogram.highest_in_bucket(bucket));
+            if (value != 0) CHECK(histogram.highest_in_bucket(bucket - 1) + 1 == histogram.lowest_in_bucket(bucket));
+        }
+    }
+
+    std::mt19937_64 rng(11);
+    std::vector<uint64_t> uniform(100000);
+    for (auto& value : uniform) value = rng() % 10000000;
+    // File sizes are closer to log-normal: mostly small, a long tail.
+    std::lognormal_distribution<double> lognormal(9, 2.5);
+    std::vector<uint64_t> sizes(100000);
+    for (auto& value : sizes) value = static_cast<uint64_t>(lognormal(rng));
+    for (unsigned precision : {1u, 3u, 6u}) {
+        check_distribution(uniform, precision);
+        check_distribution(sizes, precision);
+    }
+    check_distribution({42}, 3);
+
+    // Removing every file empties the histogram and resets its bounds.
+    SizeHistogram removed;
+    for (uint64_t value : {10, 1000, 100000}) removed.add(value);
+    for (uint64_t value : {10, 1000, 100000}) removed.remove(value);
+    CHECK(removed.total() == 0);
+    CHECK(removed.percentile(50) == 0);
+    CHECK(removed.smallest() > removed.largest());
+
+    return test::result();
+}